@@ -3,62 +3,42 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include "isa.h"
+#include "solio.h"
 #define MAXLINELENGTH 1000
 #define MAXNUMLABELS 256
 #define MAXLABELLENGTH 7 /* includes the null character termination */
 
-#define ADD 0
-#define NAND 1
-#define LW 2
-#define SW 3
-#define BEQ 4
-#define JALR 5
-#define HALT 6
-#define NOOP 7
-#define DIV 8
-#define SUB 9
-#define XSUB 10
-#define SHL 11
-#define ROL 12
-#define NOT 13
-#define JMA 14
-#define JMNBE 15
-#define CMP 16
-#define BSR 17
-#define BSF 18
-#define SETBR 19
-#define LOAD 20
-#define SAVE 21
-#define NBEQ 22
-#define NJMA 23
-#define NJMNBE 24
+typedef struct isaStruct {
+	char* mnemonic;
+	int opcode;
+	int format;
+} isaType;
 
+#define ISA_ENTRY(name, mnemonic, opcode, format, writes) \
+	{ mnemonic, opcode, format },
+static const isaType isaTable[] = { ISA_OPCODES(ISA_ENTRY) };
+#undef ISA_ENTRY
+
+void assemble(FILE*, FILE*);
+const isaType* findOpcode(char*);
 int readAndParse(FILE*, char*, char*, char*, char*, char*);
 int translateSymbol(char labelArray[MAXNUMLABELS][MAXLABELLENGTH], int labelAddress[MAXNUMLABELS], int, char*);
 int isNumber(char*);
 void testRegArg(char*);
 void testAddrArg(char*);
 
+#ifndef SOL_LIBRARY
 int
 main(int argc, char* argv[])
 {
 	char* inFileString, * outFileString;
 	FILE* inFilePtr, * outFilePtr;
-	int address;
-	char label[MAXLINELENGTH], opcode[MAXLINELENGTH], arg0[MAXLINELENGTH],
-		arg1[MAXLINELENGTH], arg2[MAXLINELENGTH], argTmp[MAXLINELENGTH];
-	int i;
-	int numLabels = 0;
-	int num;
-	int addressField , newAddressField;
-
-	char labelArray[MAXNUMLABELS][MAXLABELLENGTH];
-	int labelAddress[MAXNUMLABELS];
 
 	if (argc != 3) {
-		printf("error: usage: %s <assembly-code-file> <machine-code-file>\n",
+		solPrintf("error: usage: %s <assembly-code-file> <machine-code-file>\n",
 			argv[0]);
-		exit(1);
+		solExit(1);
 	}
 
 	inFileString = argv[1];
@@ -66,74 +46,73 @@ main(int argc, char* argv[])
 
 	inFilePtr = fopen(inFileString, "r");
 	if (inFilePtr == NULL) {
-		printf("error in opening %s\n", inFileString);
-		exit(1);
+		solPrintf("error in opening %s\n", inFileString);
+		solExit(1);
 	}
 	outFilePtr = fopen(outFileString, "w");
 	if (outFilePtr == NULL) {
-		printf("error in opening %s\n", outFileString);
-		exit(1);
+		solPrintf("error in opening %s\n", outFileString);
+		solExit(1);
 	}
 
+	assemble(inFilePtr, outFilePtr);
+
+	solExit(0);
+}
+#endif
+
+/*
+ * Assemble the program read from inFilePtr and write its machine code to
+ * outFilePtr.  Errors are reported with solPrintf and end with solExit.
+ */
+void
+assemble(FILE* inFilePtr, FILE* outFilePtr)
+{
+	int address;
+	char label[MAXLINELENGTH], opcode[MAXLINELENGTH], arg0[MAXLINELENGTH],
+		arg1[MAXLINELENGTH], arg2[MAXLINELENGTH], argTmp[MAXLINELENGTH];
+	int i;
+	int numLabels = 0;
+	int num;
+	int addressField;
+	const isaType* isa;
+	int format;
+
+	char labelArray[MAXNUMLABELS][MAXLABELLENGTH];
+	int labelAddress[MAXNUMLABELS];
+
 	/* map symbols to addresses */
 
 	/* assume address start at 0 */
 	for (address = 0; readAndParse(inFilePtr, label, opcode, arg0, arg1, arg2);
 		address++) {
 		/*
-		printf("%d: label=%s, opcode=%s, arg0=%s, arg1=%s, arg2=%s\n",
+		solPrintf("%d: label=%s, opcode=%s, arg0=%s, arg1=%s, arg2=%s\n",
 			address, label, opcode, arg0, arg1, arg2);
 		*/
 
 		/* check for illegal opcode */
-		if (strcmp(opcode, "add") && strcmp(opcode, "nand") &&
-			strcmp(opcode, "lw") && strcmp(opcode, "sw") &&
-			strcmp(opcode, "beq") && strcmp(opcode, "jalr") &&
-			strcmp(opcode, "halt") && strcmp(opcode, "noop") &&
-			strcmp(opcode, ".fill") && strcmp(opcode, "div") &&
-			strcmp(opcode, "sub") && strcmp(opcode, "xsub") &&
-			strcmp(opcode, "shl") && strcmp(opcode, "rol") &&
-			strcmp(opcode, "not") && strcmp(opcode, "jma") &&
-			strcmp(opcode, "jmnbe") && strcmp(opcode, "cmp") &&
-			strcmp(opcode, "bsr") && strcmp(opcode, "bsf") &&
-			strcmp(opcode, "setbr") && strcmp(opcode, "load") &&
-			strcmp(opcode, "save") && strcmp(opcode, "nbeq") &&
-			strcmp(opcode, "njma") && strcmp(opcode, "njmnbe")) {
-			printf("error: unrecognized opcode %s at address %d\n", opcode,
+		isa = findOpcode(opcode);
+		if (isa == NULL && strcmp(opcode, ".fill")) {
+			solPrintf("error: unrecognized opcode %s at address %d\n", opcode,
 				address);
-			exit(1);
+			solExit(1);
 		}
+		format = isa ? isa->format : FMT_NONE;
 
 		/* check register fields */
-		if (!strcmp(opcode, "add") || !strcmp(opcode, "nand") ||
-			!strcmp(opcode, "lw") || !strcmp(opcode, "sw") ||
-			!strcmp(opcode, "beq") || !strcmp(opcode, "jalr") ||
-			!strcmp(opcode, "div") || !strcmp(opcode, "sub") ||
-			!strcmp(opcode, "xsub") || !strcmp(opcode, "shl") ||
-			!strcmp(opcode, "rol") || !strcmp(opcode, "jma") ||
-			!strcmp(opcode, "jmnbe") || !strcmp(opcode, "cmp") ||
-			!strcmp(opcode, "load") || !strcmp(opcode, "save") ||
-			!strcmp(opcode, "nbeq") || !strcmp(opcode, "njma") ||
-			!strcmp(opcode, "njmnbe")) {
+		if (format & F_REGA) {
 			testRegArg(arg0);
-			testRegArg(arg1);
 		}
-		if (!strcmp(opcode, "not") || !strcmp(opcode, "bsr") ||
-			!strcmp(opcode, "bsf")) {
-			testRegArg(arg0);
+		if (format & F_REGB) {
+			testRegArg(arg1);
 		}
-		if (!strcmp(opcode, "add") || !strcmp(opcode, "nand") ||
-			!strcmp(opcode, "div") || !strcmp(opcode, "sub") ||
-			!strcmp(opcode, "xsub") || !strcmp(opcode, "shl") ||
-			!strcmp(opcode, "rol") || !strcmp(opcode, "not") ||
-			!strcmp(opcode, "bsr") || !strcmp(opcode, "bsf")) {
+		if (format & F_DEST) {
 			testRegArg(arg2);
 		}
 
 		/* check addressField */
-		if (!strcmp(opcode, "lw") || !strcmp(opcode, "sw") ||
-			!strcmp(opcode, "beq") || !strcmp(opcode, "jma") ||
-			!strcmp(opcode, "jmnbe") || !strcmp(opcode, "setbr")) {
+		if (format & (F_OFFSET | F_BROFFSET)) {
 			testAddrArg(arg2);
 		}
 		if (!strcmp(opcode, ".fill")) {
@@ -141,53 +120,46 @@ main(int argc, char* argv[])
 		}
 
 		/* check for enough arguments */
-		if ((strcmp(opcode, "halt") && strcmp(opcode, "noop") &&
-			strcmp(opcode, ".fill") && strcmp(opcode, "jalr") &&
-			strcmp(opcode, "cmp") && strcmp(opcode, "load") &&
-			strcmp(opcode, "save") && strcmp(opcode, "nbeq") &&
-			strcmp(opcode, "njma") && strcmp(opcode, "njmnbe")
-			&& arg2[0] == '\0') ||
-			(!strcmp(opcode, "not") && !strcmp(opcode, "bsr") &&
-				!strcmp(opcode, "bsf") && arg1[0] == '\0') ||
-			(!strcmp(opcode, "jalr")
-				&& arg1[0] == '\0') ||
+		if (((format & F_REGA) && arg0[0] == '\0') ||
+			((format & F_REGB) && arg1[0] == '\0') ||
+			((format & (F_DEST | F_OFFSET | F_BROFFSET)) && arg2[0] == '\0') ||
 			(!strcmp(opcode, ".fill") && arg0[0] == '\0')) {
-			printf("error at address %d: not enough arguments\n", address);
-			exit(2);
+			solPrintf("error at address %d: not enough arguments\n", address);
+			solExit(2);
 		}
 
 		if (label[0] != '\0') {
 			/* check for labels that are too long */
 			if (strlen(label) >= MAXLABELLENGTH) {
-				printf("label too long\n");
-				exit(2);
+				solPrintf("label too long\n");
+				solExit(2);
 			}
 
 			/* make sure label starts with letter */
 			if (!sscanf(label, "%[a-zA-Z]", argTmp)) {
-				printf("label doesn't start with letter\n");
-				exit(2);
+				solPrintf("label doesn't start with letter\n");
+				solExit(2);
 			}
 
 			/* make sure label consists of only letters and numbers */
 			sscanf(label, "%[a-zA-Z0-9]", argTmp);
 			if (strcmp(argTmp, label)) {
-				printf("label has character other than letters and numbers\n");
-				exit(2);
+				solPrintf("label has character other than letters and numbers\n");
+				solExit(2);
 			}
 
 			/* look for duplicate label */
 			for (i = 0; i < numLabels; i++) {
 				if (!strcmp(label, labelArray[i])) {
-					printf("error: duplicate label %s at address %d\n",
+					solPrintf("error: duplicate label %s at address %d\n",
 						label, address);
-					exit(1);
+					solExit(1);
 				}
 			}
 			/* see if there are too many labels */
 			if (numLabels >= MAXNUMLABELS) {
-				printf("error: too many labels (label=%s)\n", label);
-				exit(2);
+				solPrintf("error: too many labels (label=%s)\n", label);
+				solExit(2);
 			}
 
 			strcpy(labelArray[numLabels], label);
@@ -196,7 +168,7 @@ main(int argc, char* argv[])
 	}
 
 	for (i = 0; i < numLabels; i++) {
-		/* printf("%s = %d\n", labelArray[i], labelAddress[i]); */
+		/* solPrintf("%s = %d\n", labelArray[i], labelAddress[i]); */
 	}
 
 	/* now do second pass (print machine code, with symbols filled in as
@@ -204,130 +176,40 @@ main(int argc, char* argv[])
 	rewind(inFilePtr);
 	for (address = 0; readAndParse(inFilePtr, label, opcode, arg0, arg1, arg2);
 		address++) {
-		if (!strcmp(opcode, "add")) {
-			num = (ADD << 11) | (atoi(arg0) << 8) | (atoi(arg1) << 5)
-				| atoi(arg2);
-		}
-		else if (!strcmp(opcode, "nand")) {
-			num = (NAND << 11) | (atoi(arg0) << 8) | (atoi(arg1) << 5)
-				| atoi(arg2);
-		}
-		else if (!strcmp(opcode, "jalr")) {
-			num = (JALR << 11) | (atoi(arg0) << 8) | (atoi(arg1) << 5);
-		}
-		else if (!strcmp(opcode, "halt")) {
-			num = (HALT << 11);
-		}
-		else if (!strcmp(opcode, "noop")) {
-			num = (NOOP << 11);
-		}
-		else if (!strcmp(opcode, "div")) {
-			num = (DIV << 11) | (atoi(arg0) << 8) | (atoi(arg1) << 5)
-				| atoi(arg2);
-		}
-		else if (!strcmp(opcode, "xsub")) {
-			num = (XSUB << 11) | (atoi(arg0) << 8) | (atoi(arg1) << 5)
-				| atoi(arg2);
-		}
-		else if (!strcmp(opcode, "sub")) {
-			num = (SUB << 11) | (atoi(arg0) << 8) | (atoi(arg1) << 5)
-				| atoi(arg2);
-		}
-		else if (!strcmp(opcode, "shl")) {
-			num = (SHL << 11) | (atoi(arg0) << 8) | (atoi(arg1) << 5)
-				| atoi(arg2);
-		}
-		else if (!strcmp(opcode, "rol")) {
-			num = (ROL << 11) | (atoi(arg0) << 8) | (atoi(arg1) << 5)
-				| atoi(arg2);
-		}
-		else if (!strcmp(opcode, "not")) {
-			num = (NOT << 11) | (atoi(arg0) << 8) | atoi(arg2);
-		}
-		else if (!strcmp(opcode, "cmp")) {
-			num = (CMP << 11) | (atoi(arg0) << 8) | (atoi(arg1) << 5);
-		}
-		else if (!strcmp(opcode, "bsr")) {
-			num = (BSR << 11) | (atoi(arg0) << 8) | atoi(arg2);
-		}
-		else if (!strcmp(opcode, "bsf")) {
-			num = (BSF << 11) | (atoi(arg0) << 8) | atoi(arg2);
-		}
-		else if (!strcmp(opcode, "not")) {
-			num = (NOT << 11) | (atoi(arg0) << 8) | atoi(arg2);
-		}
-		else if (!strcmp(opcode, "load")) {
-			num = (LOAD << 11) | (atoi(arg0) << 8) | atoi(arg1) << 5;
-		}
-		else if (!strcmp(opcode, "save")) {
-			num = (SAVE << 11) | (atoi(arg0) << 8) | atoi(arg1) << 5;
-		}
-		else if (!strcmp(opcode, "nbeq")) {
-			num = (NBEQ << 11) | (atoi(arg0) << 8) | atoi(arg1) << 5;
-		}
-		else if (!strcmp(opcode, "njma")) {
-			num = (NJMA << 11) | (atoi(arg0) << 8) | atoi(arg1) << 5;
-		}
-		else if (!strcmp(opcode, "njmnbe")) {
-			num = (NJMNBE << 11) | (atoi(arg0) << 8) | atoi(arg1) << 5;
-		}
-		else if (!strcmp(opcode, "lw") || !strcmp(opcode, "sw") ||
-			!strcmp(opcode, "beq") || !strcmp(opcode, "jma") ||
-			!strcmp(opcode, "jmnbe") || !strcmp(opcode, "setbr")) {
-			/* if arg2 is symbolic, then translate into an address */
-			if (!isNumber(arg2)) {
-				addressField = translateSymbol(labelArray, labelAddress,
-					numLabels, arg2);
-				/*
-				printf("%s being translated into %d\n", arg2, addressField);
-				*/
-				if (!strcmp(opcode, "beq") || !strcmp(opcode, "jma") ||
-					!strcmp(opcode, "jmnbe")) {
-					addressField = addressField - address - 1;
+		isa = findOpcode(opcode);
+		if (isa != NULL) {
+			format = isa->format;
+			addressField = 0;
+			if (format & (F_OFFSET | F_BROFFSET)) {
+				/* if arg2 is symbolic, then translate into an address */
+				if (!isNumber(arg2)) {
+					addressField = translateSymbol(labelArray, labelAddress,
+						numLabels, arg2);
+					/*
+					solPrintf("%s being translated into %d\n", arg2, addressField);
+					*/
+					if (format & F_RELATIVE) {
+						addressField = addressField - address - 1;
+					}
+				}
+				else {
+					addressField = atoi(arg2);
 				}
-			}
-			else {
-				addressField = atoi(arg2);
-			}
-
-
-			if (addressField < -256 || addressField > 255) {
-				printf("error: offset %d out of range\n", addressField);
-				exit(1);
-			}
 
-			/* truncate the offset field, in case it's negative */
-			newAddressField = addressField & 0xFF;
-			
-			/* truncate the offset field */
-			addressField = addressField & 0x1F;
+				if (addressField < -256 || addressField > 255) {
+					solPrintf("error: offset %d out of range\n", addressField);
+					solExit(1);
+				}
 
-			if (!strcmp(opcode, "beq")) {
-				num = (BEQ << 11) | (atoi(arg0) << 8) | (atoi(arg1) << 5)
-					| addressField;
-			}
-			else if (!strcmp(opcode, "jma")) {
-				num = (JMA << 11) | (atoi(arg0) << 8) | (atoi(arg1) << 5)
-					| addressField;
-			}
-			else if (!strcmp(opcode, "jmnbe")) {
-				num = (JMNBE << 11) | (atoi(arg0) << 8) | (atoi(arg1) << 5)
-					| addressField;
+				/* truncate the offset field, in case it's negative */
+				addressField &= (format & F_BROFFSET) ? BROFFSET_MASK :
+					OFFSET_MASK;
 			}
-			else if (!strcmp(opcode, "setbr")) {
-				num = (SETBR << 11) | newAddressField;
-			}
-			else {
-				/* lw or sw */
-				if (!strcmp(opcode, "lw")) {
-					num = (LW << 11) | (atoi(arg0) << 8) |
-						(atoi(arg1) << 5) | addressField;
-				}
-				else {
-					num = (SW << 11) | (atoi(arg0) << 8) |
-						(atoi(arg1) << 5) | addressField;
-				}
+			else if (format & F_DEST) {
+				addressField = atoi(arg2);
 			}
+			num = ENCODE(isa->opcode, (format & F_REGA) ? atoi(arg0) : 0,
+				(format & F_REGB) ? atoi(arg1) : 0, addressField);
 		}
 		else if (!strcmp(opcode, ".fill")) {
 			if (!isNumber(arg0)) {
@@ -338,11 +220,9 @@ main(int argc, char* argv[])
 				num = atoi(arg0);
 			}
 		}
-		/* printf("(address %d): %d (hex 0x%x)\n", address, num, num); */
+		/* solPrintf("(address %d): %d (hex 0x%x)\n", address, num, num); */
 		fprintf(outFilePtr, "%d\n", num);
 	}
-
-	exit(0);
 }
 
 /*
@@ -354,7 +234,7 @@ main(int argc, char* argv[])
  *     0 if reached end of file
  *     1 if all went well
  *
- * exit(1) if line is too long.
+ * solExit(1) if line is too long.
  */
 int
 readAndParse(FILE* inFilePtr, char* label, char* opcode, char* arg0,
@@ -374,8 +254,8 @@ readAndParse(FILE* inFilePtr, char* label, char* opcode, char* arg0,
 
 	/* check for line too long */
 	if (strlen(line) == MAXLINELENGTH - 1) {
-		printf("error: line too long\n");
-		exit(1);
+		solPrintf("error: line too long\n");
+		solExit(1);
 	}
 
 	/* is there a label? */
@@ -405,13 +285,29 @@ translateSymbol(char labelArray[MAXNUMLABELS][MAXLABELLENGTH],
 	}
 
 	if (i >= numLabels) {
-		printf("error: missing label %s\n", symbol);
-		exit(1);
+		solPrintf("error: missing label %s\n", symbol);
+		solExit(1);
 	}
 
 	return(labelAddress[i]);
 }
 
+/*
+ * Look up an instruction mnemonic; NULL if there is no such instruction.
+ */
+const isaType*
+findOpcode(char* mnemonic)
+{
+	int i;
+
+	for (i = 0; i < NUMOPCODES; i++) {
+		if (!strcmp(mnemonic, isaTable[i].mnemonic)) {
+			return(&isaTable[i]);
+		}
+	}
+	return(NULL);
+}
+
 int
 isNumber(char* string)
 {
@@ -429,13 +325,13 @@ testRegArg(char* arg)
 	int num;
 	char c;
 
-	if (atoi(arg) < 0 || atoi(arg) >10) {
-		printf("error: register out of range\n");
-		exit(2);
+	if (atoi(arg) < 0 || atoi(arg) >= NUMREGS) {
+		solPrintf("error: register out of range\n");
+		solExit(2);
 	}
 	if (sscanf(arg, "%d%c", &num, &c) != 1) {
-		printf("bad character in register argument\n");
-		exit(2);
+		solPrintf("bad character in register argument\n");
+		solExit(2);
 	}
 }
 
@@ -451,8 +347,8 @@ testAddrArg(char* arg)
 	/* test numeric addressField */
 	if (isNumber(arg)) {
 		if (sscanf(arg, "%d%c", &num, &c) != 1) {
-			printf("bad character in addressField\n");
-			exit(2);
+			solPrintf("bad character in addressField\n");
+			solExit(2);
 		}
 	}
 }
@@ -0,0 +1,559 @@
+/*
+ * Ahead-of-time translator for the LC: turns a machine-code image into a C
+ * program that behaves like ssol on that image.
+ *
+ * Every word is translated into inline code with the same semantics ssol
+ * gives it.  Direct branches become gotos to labels on their targets; jalr
+ * and the n* jumps go through a dispatch switch on the computed pc.  The
+ * generated program prints the same final state as ssol (without the
+ * per-instruction trace) and is built with the system compiler, e.g.
+ *
+ *     csol prog.mc prog.c
+ *     cc -O2 -o prog prog.c
+ *
+ * The memory-mapped I/O ports work as in ssol, with the same options:
+ *
+ *     prog [-in <file>] [-out <file>]
+ *
+ * The translation assumes the program does not modify its own code.  The
+ * words reachable from address 0 are marked as code when the program starts,
+ * and a computed jump marks the words reachable from its target the first
+ * time it lands there; a store that would change a marked word stops the
+ * program with an error.  The translated program is a single hart, so hid
+ * always reads 0.
+ */
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "isa.h"
+
+#define MAXLINELENGTH 1000
+
+void translate(FILE*, int*, int, char*);
+void translateWord(FILE*, int, int, int);
+void successors(int, int, int*);
+void writeRuntime(FILE*);
+
+int
+main(int argc, char* argv[])
+{
+	int mem[NUMMEMORY];
+	int numMemory;
+	char line[MAXLINELENGTH];
+	FILE* inFilePtr, * outFilePtr;
+
+	if (argc != 3) {
+		printf("error: usage: %s <machine-code file> <c-file>\n", argv[0]);
+		exit(1);
+	}
+
+	inFilePtr = fopen(argv[1], "r");
+	if (inFilePtr == NULL) {
+		printf("error: can't open file %s\n", argv[1]);
+		perror("fopen");
+		exit(1);
+	}
+
+	/* read machine-code file the same way ssol does */
+	memset(mem, 0, sizeof(mem));
+	for (numMemory = 0; fgets(line, MAXLINELENGTH, inFilePtr) != NULL;
+		numMemory++) {
+		if (numMemory >= NUMMEMORY) {
+			printf("exceeded memory size\n");
+			exit(1);
+		}
+		if (sscanf(line, "%d", mem + numMemory) != 1) {
+			printf("error in reading address %d\n", numMemory);
+			exit(1);
+		}
+	}
+	fclose(inFilePtr);
+
+	outFilePtr = fopen(argv[2], "w");
+	if (outFilePtr == NULL) {
+		printf("error in opening %s\n", argv[2]);
+		exit(1);
+	}
+
+	translate(outFilePtr, mem, numMemory, argv[1]);
+
+	fclose(outFilePtr);
+	exit(0);
+}
+
+/*
+ * Write the whole translated program: the memory image, the runtime helpers,
+ * a label for every address something jumps to and, if any word makes a
+ * computed jump, the dispatch switch, which can reach every address.
+ */
+void
+translate(FILE* out, int* mem, int numMemory, char* source)
+{
+	int i;
+	int succ[2];
+	int computed = 0;
+	char label[NUMMEMORY];
+
+	memset(label, 0, sizeof(label));
+	label[0] = 1;
+	for (i = 0; i < NUMMEMORY; i++) {
+		if (OPCODE(mem[i]) == JALR || OPCODE(mem[i]) == NBEQ ||
+			OPCODE(mem[i]) == NJMA || OPCODE(mem[i]) == NJMNBE) {
+			computed = 1;
+		}
+		if (OPCODE(mem[i]) == BEQ || OPCODE(mem[i]) == JMA ||
+			OPCODE(mem[i]) == JMNBE) {
+			label[(i + 1 + OFFSET(mem[i])) & 0x1F] = 1;
+		}
+	}
+	if (computed) {
+		memset(label, 1, sizeof(label));
+	}
+
+	fprintf(out, "/* translated from %s by csol; do not edit */\n", source);
+	fprintf(out, "#include <stdio.h>\n#include <stdlib.h>\n#include <string.h>\n\n");
+	fprintf(out, "#define NUMMEMORY %d\n#define NUMREGS %d\n", NUMMEMORY,
+		NUMREGS);
+	fprintf(out, "#define BR %d\n#define IR %d\n#define ZF %d\n", BRREG, IRREG,
+		ZFREG);
+	fprintf(out, "#define IOINPORT %d\n#define IOOUTPORT %d\n"
+		"#define IOSTATUSPORT %d\n\n", IOINPORT, IOOUTPORT, IOSTATUSPORT);
+
+	fprintf(out, "static int numMemory = %d;\n", numMemory);
+	fprintf(out, "static int mem[NUMMEMORY] = {");
+	for (i = 0; i < numMemory; i++) {
+		fprintf(out, "%s%s%d", i ? "," : "", (i % 8) ? " " : "\n\t", mem[i]);
+	}
+	/* an empty initializer list is not ISO C */
+	fprintf(out, numMemory ? "\n};\n" : " 0 };\n");
+	fprintf(out, "static const int image[NUMMEMORY] = {");
+	for (i = 0; i < numMemory; i++) {
+		fprintf(out, "%s%s%d", i ? "," : "", (i % 8) ? " " : "\n\t", mem[i]);
+	}
+	fprintf(out, numMemory ? "\n};\n\n" : " 0 };\n\n");
+
+	/* where control can go after each word, -1 for nowhere or computed */
+	fprintf(out, "static const short succ[NUMMEMORY][2] = {");
+	for (i = 0; i < NUMMEMORY; i++) {
+		successors(i, mem[i], succ);
+		fprintf(out, "%s%s{ %d, %d }", i ? "," : "", (i % 4) ? " " : "\n\t",
+			succ[0], succ[1]);
+	}
+	fprintf(out, "\n};\n");
+	fprintf(out, "static char code[NUMMEMORY];\n\n");
+
+	writeRuntime(out);
+
+	fprintf(out, "int\nmain(int argc, char* argv[])\n{\n");
+	fprintf(out, "\tint reg[ZF + 1] = { 0 };\n");
+	fprintf(out, "\tint instructions = 0;\n");
+	if (computed) {
+		fprintf(out, "\tint pc = 0;\n");
+	}
+	fprintf(out, "\tint addr;\n\n");
+	fprintf(out, "\t(void)addr;\n");
+	fprintf(out, "\tioOpen(argc, argv);\n");
+	fprintf(out, "\treach(0);\n");
+	fprintf(out, "\tgoto L0;\n\n");
+
+	/* computed jumps land here with the new pc */
+	if (computed) {
+		fprintf(out, "dispatch:\n");
+		fprintf(out, "\tif (pc >= 0 && pc < NUMMEMORY && !code[pc]) reach(pc);\n");
+		fprintf(out, "\tswitch (pc) {\n");
+		for (i = 0; i < NUMMEMORY; i++) {
+			fprintf(out, "\tcase %d: goto L%d;\n", i, i);
+		}
+		fprintf(out, "\tdefault: outOfRange();\n\t}\n\n");
+	}
+
+	for (i = 0; i < NUMMEMORY; i++) {
+		translateWord(out, i, mem[i], label[i]);
+	}
+
+	/* falling off the last address is the same as ssol's range check */
+	fprintf(out, "\toutOfRange();\n");
+	fprintf(out, "\treturn(0);\n}\n");
+}
+
+/*
+ * Addresses control can reach directly after the word at address: the next
+ * one and a relative branch target.  Halt, jalr, illegal opcodes and the
+ * computed target of the n* jumps give -1.  A branch comparing a register
+ * with itself is either always taken (beq, jmnbe and their n* forms) or
+ * never taken (jma, njma), which keeps "beq 0 0 label" from flowing into
+ * the data after it.
+ */
+void
+successors(int address, int word, int* succ)
+{
+	int opcode = OPCODE(word);
+	int same = (REGA(word) == REGB(word));
+
+	succ[0] = address + 1;
+	succ[1] = -1;
+	if (opcode == BEQ || opcode == JMNBE ||
+		(opcode == JMA && !same)) {
+		succ[1] = (address + 1 + OFFSET(word)) & 0x1F;
+	}
+	if (opcode == HALT || opcode == JALR ||
+		opcode < 0 || opcode >= NUMOPCODES ||
+		(same && (opcode == BEQ || opcode == JMNBE || opcode == NBEQ ||
+		opcode == NJMNBE))) {
+		succ[0] = -1;
+	}
+}
+
+/*
+ * Translate the word at one address, with a label if anything jumps to it.
+ * Field decoding is done here, so the generated code only contains the
+ * operation with constant register numbers and offsets.
+ */
+void
+translateWord(FILE* out, int address, int word, int label)
+{
+	int opcode = OPCODE(word);
+	int arg0 = REGA(word);
+	int arg1 = REGB(word);
+	int arg2 = DESTREG(word);
+	int addressField = OFFSET(word);
+	int BRaddressField = BROFFSET(word);
+	int next = address + 1;
+	int writesReg0 = 0;
+
+	if (label) {
+		fprintf(out, "L%d:\n", address);
+	}
+	fprintf(out, "\tinstructions++;\n");
+
+	if (opcode == ADD) {
+		fprintf(out, "\treg[%d] = reg[%d] + reg[%d];\n", arg2, arg0, arg1);
+		writesReg0 = (arg2 == 0);
+	}
+	else if (opcode == NAND) {
+		fprintf(out, "\treg[%d] = ~(reg[%d] & reg[%d]);\n", arg2, arg0, arg1);
+		writesReg0 = (arg2 == 0);
+	}
+	else if (opcode == LW || opcode == LOAD) {
+		if (opcode == LW) {
+			fprintf(out, "\taddr = reg[%d] + %d;\n", arg0, addressField);
+		}
+		else {
+			fprintf(out, "\taddr = reg[%d] + (reg[BR] | reg[IR]);\n", arg0);
+		}
+		fprintf(out, "\tif (addr < 0 || addr >= NUMMEMORY) {\n");
+		fprintf(out, "\t\tif (!ioLoad(addr, &reg[%d])) outOfBounds();\n", arg1);
+		fprintf(out, "\t}\n");
+		fprintf(out, "\telse reg[%d] = mem[addr];\n", arg1);
+		writesReg0 = (arg1 == 0);
+	}
+	else if (opcode == SW || opcode == SAVE) {
+		if (opcode == SW) {
+			fprintf(out, "\taddr = reg[%d] + %d;\n", arg0, addressField);
+		}
+		else {
+			fprintf(out, "\taddr = reg[%d] + (reg[BR] | reg[IR]);\n", arg0);
+		}
+		fprintf(out, "\tif (addr < 0 || addr >= NUMMEMORY) {\n");
+		fprintf(out, "\t\tif (!ioStore(addr, reg[%d])) outOfBounds();\n", arg1);
+		fprintf(out, "\t}\n");
+		fprintf(out, "\telse {\n");
+		fprintf(out, "\t\tif (code[addr] && mem[addr] != reg[%d]) modified(addr);\n",
+			arg1);
+		fprintf(out, "\t\tmem[addr] = reg[%d];\n\t}\n", arg1);
+	}
+	else if (opcode == FAA) {
+		fprintf(out, "\taddr = reg[%d];\n", arg0);
+		fprintf(out, "\tif (addr < 0 || addr >= NUMMEMORY) outOfBounds();\n");
+		fprintf(out, "\tif (code[addr] && reg[%d] != 0) modified(addr);\n", arg1);
+		fprintf(out, "\t{\n");
+		fprintf(out, "\t\tint old = mem[addr];\n");
+		fprintf(out, "\t\tmem[addr] += reg[%d];\n", arg1);
+		fprintf(out, "\t\treg[%d] = old;\n", arg2);
+		fprintf(out, "\t}\n");
+		writesReg0 = (arg2 == 0);
+	}
+	else if (opcode == HID) {
+		fprintf(out, "\treg[%d] = 0;\n", arg0);
+	}
+	else if (opcode == BEQ || opcode == JMA || opcode == JMNBE) {
+		/* relative branches wrap around the first 32 words, as in ssol */
+		if (opcode == BEQ) {
+			fprintf(out, "\tif (reg[%d] == reg[%d])", arg0, arg1);
+		}
+		else if (opcode == JMA) {
+			fprintf(out, "\tif (reg[%d] > reg[%d])", arg0, arg1);
+		}
+		else {
+			fprintf(out, "\tif (abs(reg[%d]) >= abs(reg[%d]))", arg0, arg1);
+		}
+		fprintf(out, " goto L%d;\n", (next + addressField) & 0x1F);
+	}
+	else if (opcode == NBEQ || opcode == NJMA || opcode == NJMNBE) {
+		if (opcode == NBEQ) {
+			fprintf(out, "\tif (reg[%d] == reg[%d]) {\n", arg0, arg1);
+		}
+		else if (opcode == NJMA) {
+			fprintf(out, "\tif (reg[%d] > reg[%d]) {\n", arg0, arg1);
+		}
+		else {
+			fprintf(out, "\tif (abs(reg[%d]) >= abs(reg[%d])) {\n", arg0,
+				arg1);
+		}
+		fprintf(out, "\t\tpc = reg[BR] | reg[IR];\n");
+		fprintf(out, "\t\tgoto dispatch;\n\t}\n");
+	}
+	else if (opcode == SETBR) {
+		fprintf(out, "\treg[BR] = %d;\n", BRaddressField & 0x80);
+		fprintf(out, "\treg[IR] = %d;\n", BRaddressField & 0x7F);
+	}
+	else if (opcode == JALR) {
+		fprintf(out, "\treg[%d] = %d;\n", arg1, next);
+		if (arg0 != 0) {
+			fprintf(out, "\tpc = reg[%d];\n", arg0);
+		}
+		else {
+			fprintf(out, "\tpc = 0;\n");
+		}
+		fprintf(out, "\treg[0] = 0;\n");
+		fprintf(out, "\tgoto dispatch;\n\n");
+		return;
+	}
+	else if (opcode == NOOP) {
+	}
+	else if (opcode == HALT) {
+		fprintf(out, "\thalt(%d, reg, instructions);\n\n", next);
+		return;
+	}
+	else if (opcode == DIV) {
+		fprintf(out, "\tif (reg[%d] == 0) illegalArg2();\n", arg1);
+		fprintf(out, "\treg[%d] = abs(reg[%d] / reg[%d]);\n", arg2, arg0,
+			arg1);
+		writesReg0 = (arg2 == 0);
+	}
+	else if (opcode == SUB) {
+		fprintf(out, "\treg[%d] = reg[%d] - reg[%d];\n", arg2, arg0, arg1);
+		writesReg0 = (arg2 == 0);
+	}
+	else if (opcode == XSUB) {
+		fprintf(out, "\treg[%d] = reg[%d] - reg[%d];\n", arg0, arg0, arg1);
+		fprintf(out, "\treg[%d] = reg[%d];\n", arg2, arg0);
+		fprintf(out, "\treg[%d] = reg[%d] + reg[%d];\n", arg1, arg1, arg0);
+		fprintf(out, "\treg[%d] = reg[%d] - reg[%d];\n", arg0, arg1, arg0);
+		writesReg0 = (arg0 == 0 || arg1 == 0 || arg2 == 0);
+	}
+	else if (opcode == SHL) {
+		fprintf(out, "\treg[%d] = reg[%d] << reg[%d];\n", arg2, arg0, arg1);
+		writesReg0 = (arg2 == 0);
+	}
+	else if (opcode == ROL) {
+		fprintf(out, "\taddr = reg[%d] %% 32;\n", arg1);
+		fprintf(out, "\treg[%d] = (reg[%d] >> addr) | (reg[%d] << (32 - addr));\n",
+			arg2, arg0, arg0);
+		writesReg0 = (arg2 == 0);
+	}
+	else if (opcode == NOT) {
+		fprintf(out, "\tfor (addr = 0; addr < 32; addr++) {\n");
+		fprintf(out, "\t\treg[%d] |= (reg[%d] & (1 << addr)) ? 0 : (1 << addr);\n",
+			arg2, arg0);
+		fprintf(out, "\t}\n");
+		writesReg0 = (arg2 == 0);
+	}
+	else if (opcode == CMP) {
+		fprintf(out, "\treg[ZF] = (reg[%d] == reg[%d]);\n", arg0, arg1);
+	}
+	else if (opcode == BSR || opcode == BSF) {
+		/* reg[arg2] keeps its value when no bit is set */
+		fprintf(out, "\treg[ZF] = 0;\n");
+		if (opcode == BSR) {
+			fprintf(out, "\tfor (addr = 31; addr > -1; addr--) {\n");
+		}
+		else {
+			fprintf(out, "\tfor (addr = 0; addr < 32; addr++) {\n");
+		}
+		fprintf(out, "\t\tif (reg[%d] & (1 << addr)) {\n", arg0);
+		fprintf(out, "\t\t\treg[%d] = addr;\n", arg2);
+		fprintf(out, "\t\t\treg[ZF] = 1;\n");
+		fprintf(out, "\t\t\tbreak;\n\t\t}\n\t}\n");
+		writesReg0 = (arg2 == 0);
+	}
+	else {
+		fprintf(out, "\tillegalOpcode(%d);\n\n", opcode);
+		return;
+	}
+
+	if (writesReg0) {
+		fprintf(out, "\treg[0] = 0;\n");
+	}
+	fprintf(out, "\n");
+}
+
+/*
+ * Helpers used by the generated code; the messages match ssol's.
+ */
+void
+writeRuntime(FILE* out)
+{
+	fprintf(out,
+		"void\n"
+		"printState(int pc, int* reg)\n"
+		"{\n"
+		"\tint i;\n"
+		"\tprintf(\"\\n@@@\\nstate:\\n\");\n"
+		"\tprintf(\"\\tpc %%d\\n\", pc);\n"
+		"\tprintf(\"\\tmemory:\\n\");\n"
+		"\tfor (i = 0; i < numMemory; i++) {\n"
+		"\t\tprintf(\"\\t\\tmem[ %%d ] %%d\\n\", i, mem[i]);\n"
+		"\t}\n"
+		"\tprintf(\"\\tregisters:\\n\");\n"
+		"\tfor (i = 0; i < NUMREGS; i++) {\n"
+		"\t\tprintf(\"\\t\\treg[ %%d ] %%d\\n\", i, reg[i]);\n"
+		"\t}\n"
+		"\tprintf(\"\\t\\treg[ BR ] %%d\\n\", reg[BR]);\n"
+		"\tprintf(\"\\t\\treg[ IR ] %%d\\n\", reg[IR]);\n"
+		"\tprintf(\"\\t\\treg[ ZF ] %%d\\n\", reg[ZF]);\n"
+		"\tprintf(\"end state\\n\");\n"
+		"}\n\n");
+
+	fprintf(out,
+		"void\n"
+		"halt(int pc, int* reg, int instructions)\n"
+		"{\n"
+		"\tprintf(\"machine halted\\n\");\n"
+		"\tprintf(\"total of %%d instructions executed\\n\", instructions);\n"
+		"\tprintf(\"final state of machine:\\n\");\n"
+		"\tprintState(pc, reg);\n"
+		"\texit(0);\n"
+		"}\n\n");
+
+	fprintf(out,
+		"void\n"
+		"outOfRange(void)\n"
+		"{\n"
+		"\tprintf(\"pc went out of the memory range\\n\");\n"
+		"\texit(1);\n"
+		"}\n\n"
+		"void\n"
+		"outOfBounds(void)\n"
+		"{\n"
+		"\tprintf(\"address out of bounds\\n\");\n"
+		"\texit(1);\n"
+		"}\n\n"
+		"void\n"
+		"illegalArg2(void)\n"
+		"{\n"
+		"\tprintf(\"error: illegal arg2 \\n\");\n"
+		"\texit(1);\n"
+		"}\n\n"
+		"void\n"
+		"illegalOpcode(int opcode)\n"
+		"{\n"
+		"\tprintf(\"error: illegal opcode 0x%%x\\n\", opcode);\n"
+		"\texit(1);\n"
+		"}\n\n"
+		"void\n"
+		"modified(int address)\n"
+		"{\n"
+		"\tprintf(\"error: instruction at address %%d was modified at run time\\n\",\n"
+		"\t\taddress);\n"
+		"\texit(1);\n"
+		"}\n\n");
+
+	/*
+	 * I/O ports: the input file is read whole at startup and parsed like
+	 * ssol parses its mapped input; output goes through a large stdio
+	 * buffer that exit flushes.
+	 */
+	fprintf(out,
+		"static char* in;\n"
+		"static size_t inSize, inPos;\n"
+		"static FILE* out;\n\n"
+		"void\n"
+		"ioOpen(int argc, char* argv[])\n"
+		"{\n"
+		"\tFILE* f;\n"
+		"\tlong size;\n"
+		"\tint i;\n"
+		"\tfor (i = 1; i < argc; i++) {\n"
+		"\t\tif (!strcmp(argv[i], \"-in\") && i + 1 < argc) {\n"
+		"\t\t\tf = fopen(argv[++i], \"rb\");\n"
+		"\t\t\tif (f == NULL || fseek(f, 0, SEEK_END) != 0 ||\n"
+		"\t\t\t\t(size = ftell(f)) < 0 || fseek(f, 0, SEEK_SET) != 0 ||\n"
+		"\t\t\t\t(in = malloc(size + 1)) == NULL ||\n"
+		"\t\t\t\tfread(in, 1, size, f) != (size_t)size) {\n"
+		"\t\t\t\tprintf(\"error: can't open input file %%s\\n\", argv[i]);\n"
+		"\t\t\t\texit(1);\n"
+		"\t\t\t}\n"
+		"\t\t\tinSize = (size_t)size;\n"
+		"\t\t\tfclose(f);\n"
+		"\t\t}\n"
+		"\t\telse if (!strcmp(argv[i], \"-out\") && i + 1 < argc) {\n"
+		"\t\t\tout = fopen(argv[++i], \"wb\");\n"
+		"\t\t\tif (out == NULL) {\n"
+		"\t\t\t\tprintf(\"error: can't open output file %%s\\n\", argv[i]);\n"
+		"\t\t\t\texit(1);\n"
+		"\t\t\t}\n"
+		"\t\t\tsetvbuf(out, NULL, _IOFBF, 1 << 20);\n"
+		"\t\t}\n"
+		"\t\telse {\n"
+		"\t\t\tprintf(\"error: usage: %%s [-in <file>] [-out <file>]\\n\", argv[0]);\n"
+		"\t\t\texit(1);\n"
+		"\t\t}\n"
+		"\t}\n"
+		"}\n\n"
+		"int\n"
+		"isSpace(char c)\n"
+		"{\n"
+		"\treturn(c == ' ' || c == '\\t' || c == '\\r' || c == '\\n');\n"
+		"}\n\n"
+		"int\n"
+		"ioLoad(int addr, int* value)\n"
+		"{\n"
+		"\tlong long num = 0;\n"
+		"\tint negative = 0;\n"
+		"\tif ((addr != IOINPORT && addr != IOSTATUSPORT) || in == NULL) return(0);\n"
+		"\twhile (inPos < inSize && isSpace(in[inPos])) inPos++;\n"
+		"\tif (addr == IOSTATUSPORT) {\n"
+		"\t\t*value = inPos < inSize;\n"
+		"\t\treturn(1);\n"
+		"\t}\n"
+		"\tif (inPos < inSize && (in[inPos] == '-' || in[inPos] == '+')) {\n"
+		"\t\tnegative = in[inPos++] == '-';\n"
+		"\t}\n"
+		"\twhile (inPos < inSize && in[inPos] >= '0' && in[inPos] <= '9') {\n"
+		"\t\tnum = num * 10 + (in[inPos++] - '0');\n"
+		"\t}\n"
+		"\tif (inPos < inSize && !isSpace(in[inPos])) {\n"
+		"\t\tprintf(\"error in reading input at offset %%zu\\n\", inPos);\n"
+		"\t\texit(1);\n"
+		"\t}\n"
+		"\t*value = (int)(negative ? -num : num);\n"
+		"\treturn(1);\n"
+		"}\n\n"
+		"int\n"
+		"ioStore(int addr, int value)\n"
+		"{\n"
+		"\tif (addr != IOOUTPORT || out == NULL) return(0);\n"
+		"\tfprintf(out, \"%%d\\n\", value);\n"
+		"\treturn(1);\n"
+		"}\n\n");
+
+	/* mark the code reachable from pc, which must still be unmodified */
+	fprintf(out,
+		"void\n"
+		"reach(int pc)\n"
+		"{\n"
+		"\tint stack[2 * NUMMEMORY + 1];\n"
+		"\tint n = 0;\n"
+		"\tstack[n++] = pc;\n"
+		"\twhile (n > 0) {\n"
+		"\t\tpc = stack[--n];\n"
+		"\t\tif (pc < 0 || pc >= NUMMEMORY || code[pc]) continue;\n"
+		"\t\tif (mem[pc] != image[pc]) modified(pc);\n"
+		"\t\tcode[pc] = 1;\n"
+		"\t\tstack[n++] = succ[pc][0];\n"
+		"\t\tstack[n++] = succ[pc][1];\n"
+		"\t}\n"
+		"}\n\n");
+}
@@ -0,0 +1,114 @@
+/*
+ * Instruction set of the LC, shared by asol, ssol and csol.
+ *
+ * An instruction word is
+ *
+ *     opcode << 11 | regA << 8 | regB << 5 | low field
+ *
+ * where the low field holds destReg, a 5-bit offset or setbr's 8-bit offset.
+ * Which fields an instruction has is given by its format; asol derives its
+ * operand checks and encoding from the format, ssol and csol decode with the
+ * field macros below.  The writes column lists what an instruction writes
+ * besides its destReg (every format with F_DEST writes destReg); ssol's undo
+ * log saves exactly that before the instruction runs.  A new instruction is
+ * one line in ISA_OPCODES plus its semantics in ssol and csol.
+ */
+#ifndef ISA_H
+#define ISA_H
+
+#define NUMMEMORY 256 /* maximum number of words in memory */
+#define NUMREGS 8 /* number of machine registers */
+
+/* registers after the machine registers in the simulators' reg[] */
+#define BRREG 8 /* base register for setbr/load/save/n* jumps */
+#define IRREG 9 /* index register */
+#define ZFREG 10 /* zero flag */
+#define HIDREG 11 /* hart id, read with hid */
+
+/* memory-mapped I/O ports, just past the end of memory */
+#define IOINPORT NUMMEMORY /* load: next word of the input file */
+#define IOOUTPORT (NUMMEMORY+1) /* store: append a word to the output file */
+#define IOSTATUSPORT (NUMMEMORY+2) /* load: 1 while input remains, else 0 */
+
+/* field positions */
+#define OPCODE_SHIFT 11
+#define REGA_SHIFT 8
+#define REGB_SHIFT 5
+#define REG_MASK 0x7
+#define OFFSET_MASK 0x1F
+#define BROFFSET_MASK 0xFF
+
+#define OPCODE(word) ((word) >> OPCODE_SHIFT)
+#define REGA(word) (((word) >> REGA_SHIFT) & REG_MASK)
+#define REGB(word) (((word) >> REGB_SHIFT) & REG_MASK)
+#define DESTREG(word) ((word) & REG_MASK)
+#define OFFSET(word) ((word) & OFFSET_MASK)
+#define BROFFSET(word) ((word) & BROFFSET_MASK)
+
+#define ENCODE(opcode, regA, regB, low) (((opcode) << OPCODE_SHIFT) | \
+	((regA) << REGA_SHIFT) | ((regB) << REGB_SHIFT) | (low))
+
+/* operand fields, combined into formats */
+#define F_REGA 0x01
+#define F_REGB 0x02
+#define F_DEST 0x04
+#define F_OFFSET 0x08 /* 5-bit offset in the low field */
+#define F_BROFFSET 0x10 /* 8-bit offset in the low field */
+#define F_RELATIVE 0x20 /* a symbolic offset is relative to the next pc */
+
+#define FMT_NONE 0 /* halt, noop */
+#define FMT_RRR (F_REGA | F_REGB | F_DEST) /* regA regB destReg */
+#define FMT_RRO (F_REGA | F_REGB | F_OFFSET) /* regA regB offset */
+#define FMT_RRB (F_REGA | F_REGB | F_OFFSET | F_RELATIVE) /* regA regB label */
+#define FMT_RR (F_REGA | F_REGB) /* regA regB */
+#define FMT_RD (F_REGA | F_DEST) /* regA <unused> destReg */
+#define FMT_R F_REGA /* regA */
+#define FMT_B F_BROFFSET /* <unused> <unused> offset */
+
+/* writes besides destReg */
+#define W_NONE 0
+#define W_REGA 0x01
+#define W_REGB 0x02
+#define W_ZF 0x04
+#define W_BRIR 0x08 /* setbr's base and index registers */
+#define W_MEM 0x10 /* one memory word, logged where ssol computes its address */
+#define W_CONDDEST 0x20 /* destReg written only sometimes, logged there */
+
+/* X(name, mnemonic, opcode, format, writes); opcodes are 0..NUMOPCODES-1 */
+#define ISA_OPCODES(X) \
+	X(ADD, "add", 0, FMT_RRR, W_NONE) \
+	X(NAND, "nand", 1, FMT_RRR, W_NONE) \
+	X(LW, "lw", 2, FMT_RRO, W_REGB) \
+	X(SW, "sw", 3, FMT_RRO, W_MEM) \
+	X(BEQ, "beq", 4, FMT_RRB, W_NONE) \
+	X(JALR, "jalr", 5, FMT_RR, W_REGB) \
+	X(HALT, "halt", 6, FMT_NONE, W_NONE) \
+	X(NOOP, "noop", 7, FMT_NONE, W_NONE) \
+	X(DIV, "div", 8, FMT_RRR, W_NONE) \
+	X(SUB, "sub", 9, FMT_RRR, W_NONE) \
+	X(XSUB, "xsub", 10, FMT_RRR, W_REGA | W_REGB) \
+	X(SHL, "shl", 11, FMT_RRR, W_NONE) \
+	X(ROL, "rol", 12, FMT_RRR, W_NONE) \
+	X(NOT, "not", 13, FMT_RD, W_NONE) \
+	X(JMA, "jma", 14, FMT_RRB, W_NONE) \
+	X(JMNBE, "jmnbe", 15, FMT_RRB, W_NONE) \
+	X(CMP, "cmp", 16, FMT_RR, W_ZF) \
+	X(BSR, "bsr", 17, FMT_RD, W_ZF | W_CONDDEST) \
+	X(BSF, "bsf", 18, FMT_RD, W_ZF | W_CONDDEST) \
+	X(SETBR, "setbr", 19, FMT_B, W_BRIR) \
+	X(LOAD, "load", 20, FMT_RR, W_REGB) \
+	X(SAVE, "save", 21, FMT_RR, W_MEM) \
+	X(NBEQ, "nbeq", 22, FMT_RR, W_NONE) \
+	X(NJMA, "njma", 23, FMT_RR, W_NONE) \
+	X(NJMNBE, "njmnbe", 24, FMT_RR, W_NONE) \
+	X(FAA, "faa", 25, FMT_RRR, W_MEM) \
+	X(HID, "hid", 26, FMT_R, W_REGA)
+
+#define ISA_ENUM(name, mnemonic, opcode, format, writes) name = opcode,
+enum { ISA_OPCODES(ISA_ENUM) };
+#undef ISA_ENUM
+
+#define ISA_COUNT(name, mnemonic, opcode, format, writes) + 1
+#define NUMOPCODES (0 ISA_OPCODES(ISA_COUNT))
+
+#endif
@@ -0,0 +1,62 @@
+/*
+ * Output and exit handling shared by asol, ssol and solsrv; see solio.h.
+ */
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdarg.h>
+#include <stdlib.h>
+#include "solio.h"
+
+/* innermost active call on this thread, NULL when running as a program */
+static SOL_THREAD solCallType* current;
+
+int
+solPrintf(const char* format, ...)
+{
+	va_list args;
+	int n;
+
+	va_start(args, format);
+	n = vfprintf(current ? current->out : stdout, format, args);
+	va_end(args);
+	return(n);
+}
+
+void
+solWrite(const char* data, size_t length)
+{
+	fwrite(data, 1, length, current ? current->out : stdout);
+}
+
+void
+solExit(int status)
+{
+	if (current == NULL) {
+		exit(status);
+	}
+	current->status = status;
+	longjmp(current->env, 1);
+}
+
+void
+solEnter(solCallType* call, FILE* out)
+{
+	call->out = out ? out : current ? current->out : stdout;
+	call->status = 0;
+	call->prev = current;
+	current = call;
+}
+
+void
+solLeave(solCallType* call)
+{
+	current = call->prev;
+}
+
+/*
+ * Stream solPrintf writes to on this thread, for handing to new threads.
+ */
+FILE*
+solOutput(void)
+{
+	return(current ? current->out : stdout);
+}
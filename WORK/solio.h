@@ -0,0 +1,48 @@
+/*
+ * Output and exit handling shared by asol, ssol and solsrv.
+ *
+ * asol and ssol print with solPrintf and stop with solExit.  Run as
+ * programs this is printf and exit.  solsrv runs them in-process instead:
+ * it points the output of the calling thread at its own stream and catches
+ * solExit, so one request cannot end the server.
+ */
+#ifndef SOLIO_H
+#define SOLIO_H
+
+#include <stdio.h>
+#include <setjmp.h>
+
+#ifdef _MSC_VER
+#define SOL_THREAD __declspec(thread)
+#else
+#define SOL_THREAD _Thread_local
+#endif
+
+typedef struct solCallStruct {
+	jmp_buf env;
+	FILE* out;
+	int status;
+	struct solCallStruct* prev;
+} solCallType;
+
+int solPrintf(const char*, ...);
+void solWrite(const char*, size_t);
+void solExit(int);
+void solEnter(solCallType*, FILE*);
+void solLeave(solCallType*);
+FILE* solOutput(void);
+
+/*
+ * Usage, with call.status holding the exit status afterwards:
+ *
+ *     solEnter(&call, out);
+ *     if (setjmp(call.env) == 0) {
+ *         ...
+ *         call.status = 0;
+ *     }
+ *     solLeave(&call);
+ *
+ * An out of NULL keeps the current output and only catches solExit.
+ */
+
+#endif
@@ -0,0 +1,669 @@
+/*
+ * Simulation server for the LC: keeps asol and ssol loaded in one process
+ * and serves requests over a Unix domain socket, so a test case costs a
+ * socket round trip instead of two process starts and a .mc file.
+ *
+ * Build (POSIX only):
+ *
+ *     cc -O2 -pthread -DSOL_LIBRARY -o solsrv solsrv.c asol.c ssol.c solio.c
+ *
+ * Every request is a header line followed by a payload:
+ *
+ *     <command> <length>\n<length bytes>
+ *
+ * where command is one of
+ *
+ *     assemble       payload is assembly source, reply is the machine code
+ *     run            payload is machine code, reply is the final state
+ *     assemble+run   payload is assembly source, reply is the final state
+ *
+ * Every reply has the same shape:
+ *
+ *     <status> <length>\n<length bytes>
+ *
+ * status is the exit status asol or ssol would have had (0 on success) and
+ * the body is what they would have printed; for a failed request that is the
+ * error message.  Runs are not traced, and a run that has not halted after
+ * the instruction limit (-limit, 10000000 by default) fails with status 1.
+ *
+ * A connection may carry any number of requests.  Sockets are non-blocking
+ * and all client I/O happens on the main thread: it polls the connections,
+ * buffers each request until its header and whole payload have arrived,
+ * hands the complete request to the pool of worker threads and writes the
+ * reply the worker made.  A worker never waits on a client, so slow or idle
+ * clients do not hold one.  A client that stalls halfway through a request
+ * or its reply is dropped after IOTIMEOUT seconds.
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+#include "solio.h"
+
+#define MAXWORKERS 256
+#define MAXCONNECTIONS 1024
+#define MAXREQUEST (16 << 20) /* largest payload accepted */
+#define MAXHEADERLENGTH 100
+#define CONNBUFSIZE 65536
+#define IOTIMEOUT 10 /* seconds before a stalled client is dropped */
+#define DEFAULTLIMIT 10000000 /* instructions per run */
+
+/*
+ * One client connection.  Bytes read past the end of a request stay in buf
+ * for the next one.  The poll loop owns a connection except while it is on
+ * the ready queue or at a worker.
+ */
+typedef struct connStruct {
+	int fd;
+	char buf[CONNBUFSIZE];
+	size_t start; /* unread bytes are buf[start..end) */
+	size_t end;
+	char command[MAXHEADERLENGTH];
+	long length; /* payload length, -1 while the header is incomplete */
+	size_t have; /* payload bytes read so far */
+	char* payload;
+	size_t capacity;
+	char header[MAXHEADERLENGTH]; /* reply being written */
+	char* body;
+	struct iovec out[2]; /* what is left of header and body */
+	int closing; /* close once the reply is written */
+	time_t since; /* when a stalled request or reply last moved, else 0 */
+	struct connStruct* next; /* link in a queue */
+} connType;
+
+/* complete requests for the workers, or replies for the poll loop */
+typedef struct queueStruct {
+	connType* head;
+	connType* tail;
+} queueType;
+
+/* entry points of asol.c and ssol.c built with SOL_LIBRARY */
+void assemble(FILE*, FILE*);
+void simulate(FILE*, int, int, int, int, int);
+
+void* worker(void*);
+void pollLoop(void);
+int progress(connType*);
+void push(queueType*, connType*);
+connType* pop(queueType*);
+int readRequest(connType*);
+int fill(connType*);
+void startReply(connType*, int, char*, size_t);
+int writeReply(connType*);
+void closeConnection(connType*);
+int handle(char*, char*, size_t, char**, size_t*);
+int callAssemble(char*, size_t, char**, size_t*);
+int callSimulate(char*, size_t, char**, size_t*);
+
+int listenFd;
+int wakeFds[2]; /* written to when a reply goes back to the poll loop */
+int limit = DEFAULTLIMIT;
+queueType ready, returned;
+pthread_mutex_t queueLock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t readyCond = PTHREAD_COND_INITIALIZER;
+
+int
+main(int argc, char* argv[])
+{
+	struct sockaddr_un addr;
+	struct stat st;
+	pthread_t thread;
+	int numWorkers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	int i;
+
+	if (argc < 2) {
+		printf("error: usage: %s <socket path> [-workers <n>] "
+			"[-limit <instructions>]\n", argv[0]);
+		exit(1);
+	}
+	for (i = 2; i < argc; i++) {
+		if (!strcmp(argv[i], "-workers") && i + 1 < argc) {
+			numWorkers = atoi(argv[++i]);
+		}
+		else if (!strcmp(argv[i], "-limit") && i + 1 < argc) {
+			limit = atoi(argv[++i]);
+		}
+		else {
+			printf("error: usage: %s <socket path> [-workers <n>] "
+				"[-limit <instructions>]\n", argv[0]);
+			exit(1);
+		}
+	}
+	if (numWorkers < 1 || numWorkers > MAXWORKERS) {
+		printf("error: number of workers must be between 1 and %d\n",
+			MAXWORKERS);
+		exit(1);
+	}
+	if (limit < 1) {
+		printf("error: instruction limit must be positive\n");
+		exit(1);
+	}
+	if (strlen(argv[1]) >= sizeof(addr.sun_path)) {
+		printf("error: socket path too long\n");
+		exit(1);
+	}
+
+	/* a client going away must not kill the server */
+	signal(SIGPIPE, SIG_IGN);
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, argv[1]);
+
+	/* replace the socket of an earlier server, but nothing else */
+	if (lstat(argv[1], &st) == 0) {
+		if (!S_ISSOCK(st.st_mode)) {
+			printf("error: %s exists and is not a socket\n", argv[1]);
+			exit(1);
+		}
+		unlink(argv[1]);
+	}
+
+	listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listenFd < 0 || bind(listenFd, (struct sockaddr*)&addr,
+		sizeof(addr)) < 0 || listen(listenFd, 128) < 0 ||
+		pipe(wakeFds) < 0) {
+		printf("error: can't listen on %s\n", argv[1]);
+		perror("socket");
+		exit(1);
+	}
+
+	for (i = 0; i < numWorkers; i++) {
+		if (pthread_create(&thread, NULL, worker, NULL) != 0) {
+			printf("error: can't start worker %d\n", i);
+			exit(1);
+		}
+		pthread_detach(thread);
+	}
+	printf("listening on %s with %d workers\n", argv[1], numWorkers);
+	fflush(stdout);
+
+	pollLoop();
+	return(0);
+}
+
+/*
+ * Wait for new connections, for requests and for replies to write.  A
+ * connection with a complete request leaves the poll set for the ready
+ * queue; the worker hands it back through the returned queue with its
+ * reply.
+ */
+void
+pollLoop(void)
+{
+	struct pollfd fds[MAXCONNECTIONS + 2];
+	connType* conns[MAXCONNECTIONS];
+	connType* conn;
+	char drain[256];
+	int numConns = 0;
+	int stalled;
+	time_t now;
+	int fd;
+	int i;
+
+	for (; 1; ) {
+		fds[0].fd = listenFd;
+		fds[0].events = POLLIN;
+		fds[1].fd = wakeFds[0];
+		fds[1].events = POLLIN;
+		stalled = 0;
+		for (i = 0; i < numConns; i++) {
+			fds[i + 2].fd = conns[i]->fd;
+			fds[i + 2].events = conns[i]->out[0].iov_len +
+				conns[i]->out[1].iov_len > 0 ? POLLOUT : POLLIN;
+			stalled |= conns[i]->since != 0;
+		}
+		if (poll(fds, numConns + 2, stalled ? 1000 : -1) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			perror("poll");
+			exit(1);
+		}
+
+		/* read requests, write replies, drop stalled clients */
+		now = time(NULL);
+		for (i = numConns - 1; i >= 0; i--) {
+			if (fds[i + 2].revents != 0) {
+				if (progress(conns[i]) == 0) {
+					continue;
+				}
+			}
+			else if (conns[i]->since == 0 || now - conns[i]->since < IOTIMEOUT) {
+				continue;
+			}
+			else {
+				closeConnection(conns[i]);
+			}
+			conns[i] = conns[--numConns];
+		}
+
+		if (fds[1].revents & POLLIN) {
+			(void)read(wakeFds[0], drain, sizeof(drain));
+			for (; numConns < MAXCONNECTIONS; ) {
+				pthread_mutex_lock(&queueLock);
+				if ((conn = returned.head) != NULL) {
+					returned.head = conn->next;
+					if (returned.head == NULL) {
+						returned.tail = NULL;
+					}
+				}
+				pthread_mutex_unlock(&queueLock);
+				if (conn == NULL) {
+					break;
+				}
+				if (progress(conn) == 0) {
+					conns[numConns++] = conn;
+				}
+			}
+		}
+
+		if (fds[0].revents & POLLIN) {
+			fd = accept(listenFd, NULL, NULL);
+			if (fd < 0) {
+				continue;
+			}
+			conn = numConns < MAXCONNECTIONS ? malloc(sizeof(connType)) : NULL;
+			if (conn == NULL || fcntl(fd, F_SETFL, O_NONBLOCK) < 0) {
+				free(conn);
+				close(fd);
+				continue;
+			}
+			conn->fd = fd;
+			conn->start = conn->end = 0;
+			conn->length = -1;
+			conn->payload = NULL;
+			conn->capacity = 0;
+			conn->body = NULL;
+			conn->out[0].iov_len = conn->out[1].iov_len = 0;
+			conn->closing = 0;
+			conn->since = 0;
+			conns[numConns++] = conn;
+		}
+	}
+}
+
+/*
+ * Move a connection of the poll loop along as far as it goes without
+ * blocking: finish writing its reply, then read its next request.  Returns
+ * 0 if it stays in the poll set, 1 if it was handed to the workers or
+ * closed.
+ */
+int
+progress(connType* conn)
+{
+	int status;
+
+	for (; 1; ) {
+		if (conn->out[0].iov_len + conn->out[1].iov_len > 0) {
+			status = writeReply(conn);
+			if (status == 0) {
+				break;
+			}
+			if (status < 0 || conn->closing) {
+				closeConnection(conn);
+				return(1);
+			}
+			free(conn->body);
+			conn->body = NULL;
+		}
+		status = readRequest(conn);
+		if (status < 0) {
+			closeConnection(conn);
+			return(1);
+		}
+		if (status > 0) {
+			conn->since = 0;
+			push(&ready, conn);
+			return(1);
+		}
+		if (conn->out[0].iov_len + conn->out[1].iov_len == 0) {
+			break;
+		}
+	}
+
+	/* a request or reply that is under way must keep moving */
+	if (conn->out[0].iov_len + conn->out[1].iov_len > 0 ||
+		conn->length >= 0 || conn->end > conn->start) {
+		conn->since = time(NULL);
+	}
+	else {
+		conn->since = 0;
+	}
+	return(0);
+}
+
+void
+push(queueType* queue, connType* conn)
+{
+	pthread_mutex_lock(&queueLock);
+	conn->next = NULL;
+	if (queue->tail != NULL) {
+		queue->tail->next = conn;
+	}
+	else {
+		queue->head = conn;
+	}
+	queue->tail = conn;
+	if (queue == &ready) {
+		pthread_cond_signal(&readyCond);
+	}
+	pthread_mutex_unlock(&queueLock);
+	if (queue == &returned) {
+		(void)write(wakeFds[1], "", 1);
+	}
+}
+
+/*
+ * Take the next connection off the ready queue, waiting for one.
+ */
+connType*
+pop(queueType* queue)
+{
+	connType* conn;
+
+	pthread_mutex_lock(&queueLock);
+	while (queue->head == NULL) {
+		pthread_cond_wait(&readyCond, &queueLock);
+	}
+	conn = queue->head;
+	queue->head = conn->next;
+	if (queue->head == NULL) {
+		queue->tail = NULL;
+	}
+	pthread_mutex_unlock(&queueLock);
+	return(conn);
+}
+
+/*
+ * Worker thread: answer one complete request at a time and give the reply
+ * to the poll loop to write.
+ */
+void*
+worker(void* arg)
+{
+	connType* conn;
+	char* body;
+	size_t bodyLength;
+	int status;
+
+	(void)arg;
+	for (; 1; ) {
+		conn = pop(&ready);
+		body = NULL;
+		bodyLength = 0;
+		status = handle(conn->command, conn->payload, conn->length, &body,
+			&bodyLength);
+		conn->length = -1;
+		startReply(conn, status, body, bodyLength);
+		push(&returned, conn);
+	}
+}
+
+/*
+ * Read as much of the next request as the client has sent, without
+ * blocking.  Returns 1 once the header and the whole payload are buffered,
+ * 0 if more is to come and -1 if the connection should be closed.  A bad
+ * header gets an error reply, after which the connection is closed.
+ */
+int
+readRequest(connType* conn)
+{
+	char* newline;
+	ssize_t n;
+	char c;
+
+	if (conn->length < 0) {
+		while ((newline = memchr(conn->buf + conn->start, '\n',
+			conn->end - conn->start)) == NULL) {
+			if (conn->end - conn->start >= MAXHEADERLENGTH) {
+				startReply(conn, 2, strdup("error: bad request header\n"), 26);
+				conn->closing = 1;
+				return(0);
+			}
+			n = fill(conn);
+			if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+				return(0);
+			}
+			if (n <= 0) {
+				return(-1);
+			}
+		}
+		*newline = '\0';
+		if (newline - (conn->buf + conn->start) >= MAXHEADERLENGTH ||
+			sscanf(conn->buf + conn->start, "%s %ld%c", conn->command,
+			&conn->length, &c) != 2 || conn->length < 0 ||
+			conn->length > MAXREQUEST) {
+			conn->length = -1;
+			startReply(conn, 2, strdup("error: bad request header\n"), 26);
+			conn->closing = 1;
+			return(0);
+		}
+		conn->start = newline + 1 - conn->buf;
+
+		/* payload: what is buffered, then straight from the socket */
+		if ((size_t)conn->length + 1 > conn->capacity) {
+			free(conn->payload);
+			conn->capacity = (size_t)conn->length + 1;
+			conn->payload = malloc(conn->capacity);
+			if (conn->payload == NULL) {
+				conn->capacity = 0;
+				return(-1);
+			}
+		}
+		conn->have = conn->end - conn->start;
+		if (conn->have > (size_t)conn->length) {
+			conn->have = (size_t)conn->length;
+		}
+		memcpy(conn->payload, conn->buf + conn->start, conn->have);
+		conn->start += conn->have;
+	}
+	while (conn->have < (size_t)conn->length) {
+		n = read(conn->fd, conn->payload + conn->have,
+			conn->length - conn->have);
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+			return(0);
+		}
+		if (n <= 0) {
+			return(-1);
+		}
+		conn->have += n;
+	}
+	conn->payload[conn->length] = '\0';
+	return(1);
+}
+
+/*
+ * Read more bytes into the connection buffer.  Returns the number read, 0
+ * at end of file and -1 with errno set on error or if nothing is waiting.
+ */
+int
+fill(connType* conn)
+{
+	ssize_t n;
+
+	if (conn->start > 0) {
+		memmove(conn->buf, conn->buf + conn->start, conn->end - conn->start);
+		conn->end -= conn->start;
+		conn->start = 0;
+	}
+	do {
+		n = read(conn->fd, conn->buf + conn->end, CONNBUFSIZE - conn->end);
+	} while (n < 0 && errno == EINTR);
+	if (n > 0) {
+		conn->end += n;
+	}
+	return((int)n);
+}
+
+/*
+ * Queue a reply on a connection; the body is a malloc'ed buffer (NULL if
+ * out of memory) that is freed once it has been written.
+ */
+void
+startReply(connType* conn, int status, char* body, size_t length)
+{
+	conn->body = body;
+	conn->out[0].iov_base = conn->header;
+	conn->out[0].iov_len = snprintf(conn->header, sizeof(conn->header),
+		"%d %zu\n", status, body != NULL ? length : 0);
+	conn->out[1].iov_base = body;
+	conn->out[1].iov_len = body != NULL ? length : 0;
+}
+
+/*
+ * Write what the socket takes of the pending reply.  Returns 1 once it is
+ * all written, 0 if the rest has to wait and -1 if the client has gone away.
+ */
+int
+writeReply(connType* conn)
+{
+	ssize_t n;
+
+	while (conn->out[0].iov_len + conn->out[1].iov_len > 0) {
+		n = writev(conn->fd, conn->out, 2);
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			if (errno == EAGAIN || errno == EWOULDBLOCK) {
+				return(0);
+			}
+			return(-1);
+		}
+		if ((size_t)n >= conn->out[0].iov_len) {
+			n -= conn->out[0].iov_len;
+			conn->out[0].iov_len = 0;
+			conn->out[1].iov_base = (char*)conn->out[1].iov_base + n;
+			conn->out[1].iov_len -= n;
+		}
+		else {
+			conn->out[0].iov_base = (char*)conn->out[0].iov_base + n;
+			conn->out[0].iov_len -= n;
+		}
+	}
+	return(1);
+}
+
+void
+closeConnection(connType* conn)
+{
+	close(conn->fd);
+	free(conn->payload);
+	free(conn->body);
+	free(conn);
+}
+
+/*
+ * Execute one request.  The reply body is returned in a malloc'ed buffer.
+ */
+int
+handle(char* command, char* payload, size_t length, char** body,
+	size_t* bodyLength)
+{
+	char* machineCode;
+	size_t machineCodeLength;
+	int status;
+
+	if (!strcmp(command, "assemble")) {
+		return(callAssemble(payload, length, body, bodyLength));
+	}
+	if (!strcmp(command, "run")) {
+		return(callSimulate(payload, length, body, bodyLength));
+	}
+	if (!strcmp(command, "assemble+run")) {
+		status = callAssemble(payload, length, &machineCode,
+			&machineCodeLength);
+		if (status != 0) {
+			*body = machineCode;
+			*bodyLength = machineCodeLength;
+			return(status);
+		}
+		status = callSimulate(machineCode, machineCodeLength, body,
+			bodyLength);
+		free(machineCode);
+		return(status);
+	}
+
+	*body = strdup("error: unknown request\n");
+	*bodyLength = strlen(*body);
+	return(2);
+}
+
+/*
+ * Run asol on source.  On success the body is the machine code; on error it
+ * is the messages asol printed.
+ */
+int
+callAssemble(char* source, size_t length, char** body, size_t* bodyLength)
+{
+	solCallType call;
+	FILE* in, * out, * messages;
+	char* code = NULL, * text = NULL;
+	size_t codeLength = 0, textLength = 0;
+
+	in = fmemopen(source, length, "r");
+	out = open_memstream(&code, &codeLength);
+	messages = open_memstream(&text, &textLength);
+
+	solEnter(&call, messages);
+	if (setjmp(call.env) == 0) {
+		assemble(in, out);
+		call.status = 0;
+	}
+	solLeave(&call);
+
+	fclose(in);
+	fclose(out);
+	fclose(messages);
+	if (call.status == 0) {
+		free(text);
+		*body = code;
+		*bodyLength = codeLength;
+	}
+	else {
+		free(code);
+		*body = text;
+		*bodyLength = textLength;
+	}
+	return(call.status);
+}
+
+/*
+ * Run ssol on machine code, single hart, without trace and with the
+ * instruction limit.
+ */
+int
+callSimulate(char* machineCode, size_t length, char** body,
+	size_t* bodyLength)
+{
+	solCallType call;
+	FILE* in, * out;
+
+	in = fmemopen(machineCode, length, "r");
+	out = open_memstream(body, bodyLength);
+
+	solEnter(&call, out);
+	if (setjmp(call.env) == 0) {
+		simulate(in, 1, 0, 0, 0, limit);
+	}
+	solLeave(&call);
+
+	fclose(in);
+	fclose(out);
+	return(call.status);
+}
@@ -2,64 +2,291 @@
  * Instruction-level simulator for the LC
  */
 #define _CRT_SECURE_NO_WARNINGS
+#define _POSIX_C_SOURCE 200809L
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include "isa.h"
+#include "solio.h"
 
-#define NUMMEMORY 256 /* maximum number of words in memory */
-#define NUMREGS 8 /* number of machine registers */
-#define MAXLINELENGTH 1000
+/*
+ * Host threads and locks for -harts and the I/O ports: Win32 or pthreads.
+ * A thread body is declared THREADFUNC f(void* arg) and returns 0.
+ */
+#ifdef _WIN32
+typedef HANDLE threadType;
+typedef CRITICAL_SECTION lockType;
+#define THREADFUNC DWORD WINAPI
+#define threadCreate(t, f, arg) ((*(t) = CreateThread(NULL, 0, f, arg, 0, \
+	NULL)) != NULL)
+#define threadJoin(t) (WaitForSingleObject(t, INFINITE), CloseHandle(t))
+#define lockInit(l) InitializeCriticalSection(l)
+#define lockTake(l) EnterCriticalSection(l)
+#define lockGive(l) LeaveCriticalSection(l)
+#else
+typedef pthread_t threadType;
+typedef pthread_mutex_t lockType;
+#define THREADFUNC void*
+#define threadCreate(t, f, arg) (pthread_create(t, NULL, f, arg) == 0)
+#define threadJoin(t) pthread_join(t, NULL)
+#define lockInit(l) pthread_mutex_init(l, NULL)
+#define lockTake(l) pthread_mutex_lock(l)
+#define lockGive(l) pthread_mutex_unlock(l)
+#endif
 
-#define ADD 0
-#define NAND 1
-#define LW 2
-#define SW 3
-#define BEQ 4
-#define JALR 5
-#define HALT 6
-#define NOOP 7
-#define DIV 8
-#define SUB 9
-#define XSUB 10
-#define SHL 11
-#define ROL 12
-#define NOT 13
-#define JMA 14
-#define JMNBE 15
-#define CMP 16
-#define BSR 17
-#define BSF 18
-#define SETBR 19
-#define LOAD 20
-#define SAVE 21
-#define NBEQ 22
-#define NJMA 23
-#define NJMNBE 24
+/*
+ * Loads and stores of shared memory words.  Harts on other threads may
+ * access the same word, so these are relaxed atomics, which compile to
+ * plain moves on x86 and ARM.
+ */
+#ifdef _MSC_VER
+#define LOADWORD(p) (*(volatile int*)(p))
+#define STOREWORD(p, value) (*(volatile int*)(p) = (value))
+#else
+#define LOADWORD(p) __atomic_load_n(p, __ATOMIC_RELAXED)
+#define STOREWORD(p, value) __atomic_store_n(p, value, __ATOMIC_RELAXED)
+#endif
+
+#define MAXLINELENGTH 1000
+#define MAXHARTS 64
+#define IOBUFSIZE (1 << 20) /* output buffer of the I/O ports */
 
 typedef struct stateStruct {
 	int pc;
 	int mem[NUMMEMORY];
-	int reg[NUMREGS+3];
+	int reg[HIDREG+1];
 	int numMemory;
 } stateType;
 
+/*
+ * One simulated core.  Every hart has its own pc and register file; memory
+ * is shared by all harts of a run.  A hart on its own thread that stops with
+ * an error keeps its exit status in status and sets *stop, which makes the
+ * other harts of the run stop too.
+ */
+typedef struct hartStruct {
+	int pc;
+	int reg[HIDREG+1];
+	int instructions;
+	int halted;
+	int status;
+	int* stop;
+	int* mem;
+	FILE* out;
+} hartType;
+
+/*
+ * Streams behind the I/O ports.  Both files hold one decimal word per line,
+ * like a .mc file.  The input file is mapped into memory and parsed in
+ * place; output is formatted into a large buffer that is written out when
+ * it fills up and at exit.
+ */
+typedef struct ioStruct {
+	const char* in;
+	size_t inSize;
+	size_t inPos;
+	FILE* out;
+	char* outBuf;
+	size_t outLen;
+	lockType lock;
+} ioType;
+
+ioType io;
+
+/*
+ * Text of the last state printed by printState on this thread, with the
+ * place of every value in it: pc, then mem[], then reg[] including BR, IR
+ * and ZF.
+ */
+#define NUMTRACEVALUES (1 + NUMMEMORY + NUMREGS + 3)
+#define MAXTRACELENGTH (64 + NUMTRACEVALUES * 32)
+
+typedef struct traceStruct {
+	char block[MAXTRACELENGTH];
+	int length;
+	int numMemory;
+	int numValues; /* 0 until the first block is built */
+	int value[NUMTRACEVALUES];
+	int offset[NUMTRACEVALUES];
+	int width[NUMTRACEVALUES];
+} traceType;
+
+static SOL_THREAD traceType traceCache;
+
+/* append a string literal to the block being built */
+#define TRACETEXT(p, text) (memcpy(p, text, sizeof(text) - 1), \
+	(p) += sizeof(text) - 1)
+
+/*
+ * Undo log for reverse execution (-undo).  Before an instruction overwrites
+ * a word, the word is logged with its old value; the first entry of an
+ * instruction also carries its pc, the others have pc -1, and an instruction
+ * that overwrites nothing gets a single UNDONONE entry once the next one
+ * starts.  Which registers an instruction writes comes from undoWrites,
+ * built from the format and writes columns of ISA_OPCODES; memory and
+ * bsr/bsf's destReg are logged by step where it writes them.  The entries
+ * live in a ring allocated once at startup; when it fills up the oldest
+ * instructions are dropped.  Words moved through the I/O ports are not
+ * undone.
+ */
+#define UNDONONE -1 /* where: nothing overwritten */
+#define UNDOMEM 16 /* where: UNDOMEM + address for mem[], else a register */
+#define MAXUNDOWRITES 3 /* most entries one instruction needs (xsub) */
+#define MINUNDOSIZE 4
+#define UNDODEST 0x80 /* undoWrites: destReg, from the format */
+#define UNDOKNOWN (W_REGA | W_REGB | W_ZF | W_BRIR | W_MEM | W_CONDDEST)
+
+#define UNDOWRITES(name, mnemonic, opcode, format, writes) \
+	[opcode] = (writes) | \
+		((format) & F_DEST && !((writes) & W_CONDDEST) ? UNDODEST : 0),
+static const unsigned char undoWrites[] = { ISA_OPCODES(UNDOWRITES) };
+#undef UNDOWRITES
+
+/* fails to compile if an instruction's writes are not all logged */
+#define UNDOCHECK(name, mnemonic, opcode, format, writes) \
+	typedef char undoCheck##name[((writes) & ~UNDOKNOWN) == 0 && \
+		(!((writes) & W_CONDDEST) || ((format) & F_DEST)) ? 1 : -1];
+ISA_OPCODES(UNDOCHECK)
+#undef UNDOCHECK
+
+typedef struct undoEntryStruct {
+	int old;
+	short where;
+	short pc;
+} undoEntryType;
+
+typedef struct undoStruct {
+	undoEntryType* entry; /* the ring, a power of two entries long */
+	unsigned int mask; /* ring size - 1 */
+	unsigned int head; /* entries ever written; the next is entry[head&mask] */
+	unsigned int tail; /* first entry still in the log */
+	unsigned int limit; /* entries in use beyond which old ones are dropped */
+	int instructions; /* instructions in the log */
+	int pc; /* pc for the next entry, -1 once the instruction has one */
+} undoType;
+
 void printState(stateType*);
-void run(stateType);
-int convertNum(int);
+void buildTrace(stateType*);
+char* traceValue(char*, int);
+void updateTrace(int, int);
+int formatInt(char*, int);
+void printHarts(stateType*, hartType*, int);
+void simulate(FILE*, int, int, int, int, int);
+void run(stateType, int, int, int);
+void execute(stateType*, int, undoType*, int);
+void runHarts(stateType, int, int);
+THREADFUNC runHart(void*);
+void executeHart(hartType*);
+int step(int*, int*, int*, undoType*);
+int fetchAdd(int*, int);
+void ioOpenInput(char*);
+void ioOpenOutput(char*);
+void ioFlush(void);
+int ioLoad(int, int*);
+int ioStore(int, int);
+undoType* undoCreate(int);
+static void undoRecord(undoType*, int, int, int*);
+void undoPush(undoType*, int, int);
+void undoFlush(undoType*);
+void undoDrop(undoType*);
+int undoBack(undoType*, stateType*);
+int undoFind(undoType*, int, int*, int*);
+void debug(undoType*, stateType*);
 
+#ifndef SOL_LIBRARY
 int
 main(int argc, char* argv[])
 {
 	int i;
-	char line[MAXLINELENGTH];
-	stateType state;
 	FILE* filePtr;
+	int numHarts = 1;
+	int deterministic = 0;
+	int trace = 1;
+	int undoSize = 0;
+
+	if (argc < 2) {
+		solPrintf("error: usage: %s <machine-code file> [-q] [-harts <n>] [-det] "
+			"[-in <file>] [-out <file>] [-undo <n>]\n", argv[0]);
+		solExit(1);
+	}
+	lockInit(&io.lock);
+	for (i = 2; i < argc; i++) {
+		if (!strcmp(argv[i], "-q")) {
+			trace = 0;
+		}
+		else if (!strcmp(argv[i], "-harts") && i + 1 < argc) {
+			numHarts = atoi(argv[++i]);
+		}
+		else if (!strcmp(argv[i], "-det")) {
+			deterministic = 1;
+		}
+		else if (!strcmp(argv[i], "-in") && i + 1 < argc) {
+			ioOpenInput(argv[++i]);
+		}
+		else if (!strcmp(argv[i], "-out") && i + 1 < argc) {
+			ioOpenOutput(argv[++i]);
+		}
+		else if (!strcmp(argv[i], "-undo") && i + 1 < argc) {
+			undoSize = atoi(argv[++i]);
+		}
+		else {
+			solPrintf("error: usage: %s <machine-code file> [-q] [-harts <n>] "
+				"[-det] [-in <file>] [-out <file>] [-undo <n>]\n", argv[0]);
+			solExit(1);
+		}
+	}
+	if (numHarts < 1 || numHarts > MAXHARTS) {
+		solPrintf("error: number of harts must be between 1 and %d\n", MAXHARTS);
+		solExit(1);
+	}
+	if (undoSize != 0 && (undoSize < MINUNDOSIZE || numHarts != 1)) {
+		solPrintf("error: the undo log needs a single hart and at least %d "
+			"entries\n", MINUNDOSIZE);
+		solExit(1);
+	}
 
-	if (argc != 2) {
-		printf("error: usage: %s <machine-code file>\n", argv[0]);
-		exit(1);
+	filePtr = fopen(argv[1], "r");
+	if (filePtr == NULL) {
+		solPrintf("error: can't open file %s\n", argv[1]);
+		perror("fopen");
+		solExit(1);
 	}
 
+	simulate(filePtr, numHarts, deterministic, trace, undoSize, 0);
+
+	return(0);
+}
+#endif
+
+/*
+ * Load the machine code read from filePtr and run it.  Without trace only
+ * the final state is printed.  A nonzero undoSize keeps an undo log of that
+ * many entries and opens the reverse-execution prompt when the run stops.
+ * A single hart that has not halted after maxInstructions instructions is
+ * stopped with an error; 0 means no limit.  Never returns: the run ends with
+ * solExit.
+ */
+void
+simulate(FILE* filePtr, int numHarts, int deterministic, int trace,
+	int undoSize, int maxInstructions)
+{
+	int i;
+	char line[MAXLINELENGTH];
+	stateType state;
+
 	/* initialize memories and registers */
 	for (i = 0; i < NUMMEMORY; i++) {
 		state.mem[i] = 0;
@@ -67,289 +294,1017 @@ main(int argc, char* argv[])
 	for (i = 0; i < NUMREGS; i++) {
 		state.reg[i] = 0;
 	}
-	state.reg[8] = 0;
-	state.reg[9] = 0;
-	state.reg[10] = 0;
+	state.reg[BRREG] = 0;
+	state.reg[IRREG] = 0;
+	state.reg[ZFREG] = 0;
+	state.reg[HIDREG] = 0;
 	state.pc = 0;
 
 	/* read machine-code file into instruction/data memory (starting at
 	address 0) */
 
-	filePtr = fopen(argv[1], "r");
-	if (filePtr == NULL) {
-		printf("error: can't open file %s\n", argv[1]);
-		perror("fopen");
-		exit(1);
-	}
-
 	for (state.numMemory = 0; fgets(line, MAXLINELENGTH, filePtr) != NULL;
 		state.numMemory++) {
 		if (state.numMemory >= NUMMEMORY) {
-			printf("exceeded memory size\n");
-			exit(1);
+			solPrintf("exceeded memory size\n");
+			solExit(1);
 		}
 		if (sscanf(line, "%d", state.mem + state.numMemory) != 1) {
-			printf("error in reading address %d\n", state.numMemory);
-			exit(1);
+			solPrintf("error in reading address %d\n", state.numMemory);
+			solExit(1);
+		}
+		if (trace) {
+			solPrintf("memory[%d]=%d\n", state.numMemory,
+				state.mem[state.numMemory]);
 		}
-		printf("memory[%d]=%d\n", state.numMemory, state.mem[state.numMemory]);
 	}
 
-	printf("\n");
+	if (trace) {
+		solPrintf("\n");
+	}
+
+	/* neither run nor runHarts returns */
+	if (numHarts == 1) {
+		run(state, trace, undoSize, maxInstructions);
+	}
+	runHarts(state, numHarts, deterministic);
+}
 
-	/* run never returns */
-	run(state);
+/*
+ * Run a single hart.  With an undo log, the way the run stops is caught and
+ * the reverse-execution prompt is opened on the state it stopped in.
+ */
+void
+run(stateType state, int trace, int undoSize, int maxInstructions)
+{
+	undoType* undo;
+	solCallType call;
 
-	return(0);
+	if (undoSize == 0) {
+		execute(&state, trace, NULL, maxInstructions);
+	}
+	undo = undoCreate(undoSize);
+	solEnter(&call, NULL);
+	if (setjmp(call.env) == 0) {
+		execute(&state, trace, undo, maxInstructions);
+	}
+	solLeave(&call);
+	debug(undo, &state);
+	solExit(call.status);
 }
 
 void
-run(stateType state)
+execute(stateType* statePtr, int trace, undoType* undo, int maxInstructions)
 {
-	int arg0, arg1, arg2, addressField, newAddressField, BRaddressField;
 	int instructions = 0;
-	int opcode;
-	int maxMem = -1;	/* highest memory address touched during run */
-	int ZF = 10;
-	int IR = 9;
-	int BR = 8;
-
-	
 
 	for (; 1; instructions++) { /* infinite loop, exits when it executes halt */
-		printState(&state);
+		if (trace) {
+			printState(statePtr);
+		}
 
-		if (state.pc < 0 || state.pc >= NUMMEMORY) {
-			printf("pc went out of the memory range\n");
-			exit(1);
+		if (statePtr->pc < 0 || statePtr->pc >= NUMMEMORY) {
+			solPrintf("pc went out of the memory range\n");
+			solExit(1);
+		}
+		if (maxInstructions > 0 && instructions >= maxInstructions) {
+			solPrintf("error: no halt after %d instructions\n", maxInstructions);
+			solExit(1);
 		}
 
-		maxMem = (state.pc > maxMem) ? state.pc : maxMem;
+		if (step(&statePtr->pc, statePtr->reg, statePtr->mem, undo)) {
+			solPrintf("machine halted\n");
+			solPrintf("total of %d instructions executed\n", instructions + 1);
+			solPrintf("final state of machine:\n");
+			printState(statePtr);
+			solExit(0);
+		}
+	}
+}
 
-		/* this is to make the following code easier to read */
-		opcode = state.mem[state.pc] >> 11;
-		arg0 = (state.mem[state.pc] >> 8) & 0x7;
-		arg1 = (state.mem[state.pc] >> 5) & 0x7;
-		arg2 = state.mem[state.pc] & 0x7; /* only for add, nand */
+/*
+ * Run several harts on one shared memory.  Each hart starts at pc 0 with its
+ * id in the hid register and runs until it executes halt.  Harts run on their
+ * own host threads; with deterministic set they are instead stepped one
+ * instruction at a time in hart order on the calling thread, so every run of
+ * a program gives the same interleaving.  No per-instruction trace is printed.
+ */
+void
+runHarts(stateType state, int numHarts, int deterministic)
+{
+	hartType harts[MAXHARTS];
+	threadType threads[MAXHARTS];
+	int running;
+	int stop = 0;
+	int i, n;
 
-		addressField = convertNum(state.mem[state.pc] & 0x1F); /* for beq, lw, sw */
-		BRaddressField = convertNum(state.mem[state.pc] & 0xFF); /* for setbr */
-		newAddressField = state.reg[BR] | state.reg[IR];
-		state.pc++;
-		if (opcode == ADD) {
-			state.reg[arg2] = state.reg[arg0] + state.reg[arg1];
-		}
-		else if (opcode == NAND) {
-			state.reg[arg2] = ~(state.reg[arg0] & state.reg[arg1]);
-		}
-		else if (opcode == LW) {
-			if (state.reg[arg0] + addressField < 0 ||
-				state.reg[arg0] + addressField >= NUMMEMORY) {
-				printf("address out of bounds\n");
-				exit(1);
-			}
-			state.reg[arg1] = state.mem[state.reg[arg0] + addressField];
-			if (state.reg[arg0] + addressField > maxMem) {
-				maxMem = state.reg[arg0] + addressField;
+	for (i = 0; i < numHarts; i++) {
+		memcpy(harts[i].reg, state.reg, sizeof(state.reg));
+		harts[i].reg[HIDREG] = i;
+		harts[i].pc = state.pc;
+		harts[i].instructions = 0;
+		harts[i].halted = 0;
+		harts[i].status = 0;
+		harts[i].stop = &stop;
+		harts[i].mem = state.mem;
+		harts[i].out = solOutput();
+	}
+
+	if (deterministic) {
+		for (running = numHarts; running > 0; ) {
+			for (i = 0; i < numHarts; i++) {
+				if (harts[i].halted) {
+					continue;
+				}
+				if (harts[i].pc < 0 || harts[i].pc >= NUMMEMORY) {
+					solPrintf("pc of hart %d went out of the memory range\n", i);
+					solExit(1);
+				}
+				harts[i].instructions++;
+				if (step(&harts[i].pc, harts[i].reg, harts[i].mem, NULL)) {
+					harts[i].halted = 1;
+					running--;
+				}
 			}
 		}
-		else if (opcode == LOAD) {
-			if (state.reg[arg0] + newAddressField < 0 ||
-				state.reg[arg0] + newAddressField >= NUMMEMORY) {
-				printf("address out of bounds\n");
-				exit(1);
-			}
-			state.reg[arg1] = state.mem[state.reg[arg0] + newAddressField];
-			if (state.reg[arg0] + newAddressField > maxMem) {
-				maxMem = state.reg[arg0] + newAddressField;
+	}
+	else {
+		/* only this thread exits, once every hart thread has been joined */
+		for (n = 0; n < numHarts; n++) {
+			if (!threadCreate(&threads[n], runHart, &harts[n])) {
+				solPrintf("error: can't start thread for hart %d\n", n);
+				STOREWORD(&stop, 1);
+				break;
 			}
 		}
-		else if (opcode == SW) {
-			if (state.reg[arg0] + addressField < 0 ||
-				state.reg[arg0] + addressField >= NUMMEMORY) {
-				printf("address out of bounds\n");
-				exit(1);
-			}
-			state.mem[state.reg[arg0] + addressField] = state.reg[arg1];
-			if (state.reg[arg0] + addressField > maxMem) {
-				maxMem = state.reg[arg0] + addressField;
-			}
+		for (i = 0; i < n; i++) {
+			threadJoin(threads[i]);
 		}
-		else if (opcode == SAVE) {
-			if (state.reg[arg0] + newAddressField < 0 ||
-				state.reg[arg0] + newAddressField >= NUMMEMORY) {
-				printf("address out of bounds\n");
-				exit(1);
-			}
-			state.mem[state.reg[arg0] + newAddressField] = state.reg[arg1];
-			if (state.reg[arg0] + newAddressField > maxMem) {
-				maxMem = state.reg[arg0] + newAddressField;
-			}
+		if (n < numHarts) {
+			solExit(1);
 		}
-		else if (opcode == BEQ) {
-			if (state.reg[arg0] == state.reg[arg1]) {
-				state.pc += addressField;
-				state.pc = state.pc & 0x1F;
+		for (i = 0; i < numHarts; i++) {
+			if (harts[i].status != 0) {
+				solExit(harts[i].status);
 			}
 		}
-		else if (opcode == NBEQ) {
-			if (state.reg[arg0] == state.reg[arg1]) {
-				state.pc = newAddressField;
-			}
+	}
+
+	solPrintf("machine halted\n");
+	for (i = 0; i < numHarts; i++) {
+		solPrintf("hart %d: total of %d instructions executed\n", i,
+			harts[i].instructions);
+	}
+	solPrintf("final state of machine:\n");
+	printHarts(&state, harts, numHarts);
+	solExit(0);
+}
+
+/*
+ * Thread body for one hart: run it until it executes halt or some hart has
+ * stopped with an error.  An error here is caught rather than ending the
+ * process while other harts are still running.
+ */
+THREADFUNC
+runHart(void* arg)
+{
+	hartType* hart = (hartType*)arg;
+	solCallType call;
+
+	solEnter(&call, hart->out);
+	if (setjmp(call.env) == 0) {
+		executeHart(hart);
+	}
+	solLeave(&call);
+	if (call.status != 0) {
+		hart->status = call.status;
+		STOREWORD(hart->stop, 1);
+	}
+	return(0);
+}
+
+/*
+ * Loop of runHart.  The hart runs on a copy in this thread's stack frame, so
+ * that harts on different threads never write to the same cache line; the
+ * copy goes back to *hart when the hart halts or is stopped.
+ */
+void
+executeHart(hartType* hart)
+{
+	hartType local = *hart;
+
+	while (!LOADWORD(local.stop)) {
+		if (local.pc < 0 || local.pc >= NUMMEMORY) {
+			solPrintf("pc of hart %d went out of the memory range\n",
+				local.reg[HIDREG]);
+			solExit(1);
 		}
-		else if (opcode == JMA) {
-			if (state.reg[arg0] > state.reg[arg1]) {
-				state.pc += addressField;
-				state.pc = state.pc & 0x1F;
-			}
+		local.instructions++;
+		if (step(&local.pc, local.reg, local.mem, NULL)) {
+			local.halted = 1;
+			break;
 		}
-		else if (opcode == NJMA) {
-			if (state.reg[arg0] > state.reg[arg1]) {
-				state.pc = newAddressField;
+	}
+	*hart = local;
+}
+
+/*
+ * Execute the instruction at *pc.  Returns 1 if it was halt (with *pc
+ * already advanced past it), 0 otherwise.  Each case decodes only the
+ * fields its format has.  With an undo log, the old value of every word the
+ * instruction overwrites is logged first.
+ */
+int
+step(int* pc, int* reg, int* mem, undoType* undo)
+{
+	int word = LOADWORD(&mem[*pc]);
+	int arg0 = REGA(word);
+	int arg1, arg2, address;
+
+	if (undo != NULL) {
+		undoRecord(undo, *pc, word, reg);
+	}
+	(*pc)++;
+	switch (OPCODE(word)) {
+	case ADD:
+		reg[DESTREG(word)] = reg[arg0] + reg[REGB(word)];
+		break;
+	case NAND:
+		reg[DESTREG(word)] = ~(reg[arg0] & reg[REGB(word)]);
+		break;
+	case LW:
+	case LOAD:
+		address = reg[arg0] + (OPCODE(word) == LW ? OFFSET(word) :
+			(reg[BRREG] | reg[IRREG]));
+		if (address < 0 || address >= NUMMEMORY) {
+			if (!ioLoad(address, &reg[REGB(word)])) {
+				solPrintf("address out of bounds\n");
+				solExit(1);
 			}
 		}
-		else if (opcode == JMNBE) {
-			if (abs(state.reg[arg0]) >= abs(state.reg[arg1])) {
-				state.pc += addressField;
-				state.pc = state.pc & 0x1F;
+		else {
+			reg[REGB(word)] = LOADWORD(&mem[address]);
+		}
+		break;
+	case SW:
+	case SAVE:
+		address = reg[arg0] + (OPCODE(word) == SW ? OFFSET(word) :
+			(reg[BRREG] | reg[IRREG]));
+		if (address < 0 || address >= NUMMEMORY) {
+			if (!ioStore(address, reg[REGB(word)])) {
+				solPrintf("address out of bounds\n");
+				solExit(1);
 			}
 		}
-		else if (opcode == NJMNBE) {
-			if (abs(state.reg[arg0]) >= abs(state.reg[arg1])) {
-				state.pc = newAddressField;
+		else {
+			if (undo != NULL) {
+				undoPush(undo, UNDOMEM + address, LOADWORD(&mem[address]));
 			}
+			STOREWORD(&mem[address], reg[REGB(word)]);
 		}
-		else if (opcode == SETBR) {
-			state.reg[BR] = BRaddressField & 0x80;
-			state.reg[IR] = BRaddressField & 0x7F;
+		break;
+	case FAA:
+		if (reg[arg0] < 0 || reg[arg0] >= NUMMEMORY) {
+			solPrintf("address out of bounds\n");
+			solExit(1);
 		}
-		else if (opcode == JALR) {
-			state.reg[arg1] = state.pc;
-			if (arg0 != 0)
-				state.pc = state.reg[arg0];
-			else
-				state.pc = 0;
+		if (undo != NULL) {
+			undoPush(undo, UNDOMEM + reg[arg0], LOADWORD(&mem[reg[arg0]]));
 		}
-		else if (opcode == NOOP) {
+		reg[DESTREG(word)] = fetchAdd(&mem[reg[arg0]], reg[REGB(word)]);
+		break;
+	case BEQ:
+		if (reg[arg0] == reg[REGB(word)]) {
+			*pc = (*pc + OFFSET(word)) & 0x1F;
 		}
-		else if (opcode == HALT) {
-			printf("machine halted\n");
-			printf("total of %d instructions executed\n", instructions + 1);
-			printf("final state of machine:\n");
-			printState(&state);
-			exit(0);
+		break;
+	case NBEQ:
+		if (reg[arg0] == reg[REGB(word)]) {
+			*pc = reg[BRREG] | reg[IRREG];
 		}
-		else if (opcode == DIV) {
-			if (state.reg[arg1] != 0) {
-
-				state.reg[arg2] = abs(state.reg[arg0] / state.reg[arg1]);
-			}
-			else {
-				printf("error: illegal arg2 \n");
-				exit(1);
-			}
+		break;
+	case JMA:
+		if (reg[arg0] > reg[REGB(word)]) {
+			*pc = (*pc + OFFSET(word)) & 0x1F;
 		}
-		else if (opcode == SUB) {
-			state.reg[arg2] = state.reg[arg0] - state.reg[arg1];
+		break;
+	case NJMA:
+		if (reg[arg0] > reg[REGB(word)]) {
+			*pc = reg[BRREG] | reg[IRREG];
 		}
-		else if (opcode == XSUB) {
-			state.reg[arg0] = state.reg[arg0] - state.reg[arg1];
-			state.reg[arg2] = state.reg[arg0];
-			state.reg[arg1] = state.reg[arg1] + state.reg[arg0];
-			state.reg[arg0] = state.reg[arg1] - state.reg[arg0];
+		break;
+	case JMNBE:
+		if (abs(reg[arg0]) >= abs(reg[REGB(word)])) {
+			*pc = (*pc + OFFSET(word)) & 0x1F;
 		}
-		else if (opcode == SHL) {
-			state.reg[arg2] = state.reg[arg0] << state.reg[arg1];
+		break;
+	case NJMNBE:
+		if (abs(reg[arg0]) >= abs(reg[REGB(word)])) {
+			*pc = reg[BRREG] | reg[IRREG];
 		}
-		else if (opcode == ROL) {
-
-			int size = sizeof(state.reg[arg0]) * 8;
-			int positions = state.reg[arg1] % size;
-			state.reg[arg2] = (state.reg[arg0] >> positions) | (state.reg[arg0] << (size - positions));
+		break;
+	case SETBR:
+		reg[BRREG] = BROFFSET(word) & 0x80;
+		reg[IRREG] = BROFFSET(word) & 0x7F;
+		break;
+	case JALR:
+		reg[REGB(word)] = *pc;
+		if (arg0 != 0)
+			*pc = reg[arg0];
+		else
+			*pc = 0;
+		break;
+	case NOOP:
+		break;
+	case HALT:
+		return(1);
+	case HID:
+		reg[arg0] = reg[HIDREG];
+		break;
+	case DIV:
+		arg1 = REGB(word);
+		if (reg[arg1] != 0) {
+			reg[DESTREG(word)] = abs(reg[arg0] / reg[arg1]);
 		}
-		else if (opcode == NOT) {
-			for (int i = 0; i < 32; i++) {
-				state.reg[arg2] |= (state.reg[arg0] & (1 << i)) ? 0 : (1 << i);
-			}
+		else {
+			solPrintf("error: illegal arg2 \n");
+			solExit(1);
 		}
-		else if (opcode == CMP) {
-			if (state.reg[arg0] < state.reg[arg1])
-			{
-				state.reg[ZF] = 0;
-			}
-			if (state.reg[arg0] == state.reg[arg1])
-			{
-				state.reg[ZF] = 1;
-			}
-			if (state.reg[arg0] > state.reg[arg1])
-			{
-				state.reg[ZF] = 0;
-			}
+		break;
+	case SUB:
+		reg[DESTREG(word)] = reg[arg0] - reg[REGB(word)];
+		break;
+	case XSUB:
+		arg1 = REGB(word);
+		arg2 = DESTREG(word);
+		reg[arg0] = reg[arg0] - reg[arg1];
+		reg[arg2] = reg[arg0];
+		reg[arg1] = reg[arg1] + reg[arg0];
+		reg[arg0] = reg[arg1] - reg[arg0];
+		break;
+	case SHL:
+		reg[DESTREG(word)] = reg[arg0] << reg[REGB(word)];
+		break;
+	case ROL: {
+		int size = sizeof(reg[arg0]) * 8;
+		int positions = reg[REGB(word)] % size;
+		reg[DESTREG(word)] = (reg[arg0] >> positions) |
+			(reg[arg0] << (size - positions));
+		break;
+	}
+	case NOT:
+		arg2 = DESTREG(word);
+		for (int i = 0; i < 32; i++) {
+			reg[arg2] |= (reg[arg0] & (1 << i)) ? 0 : (1 << i);
 		}
-		else if (opcode == BSR) {
-			for (int i = 31; i > -1; i--) {
-				int res = state.reg[arg0] & (1 << i);
-				if (res != 0)
-				{
-					state.reg[arg2] = i;
-					state.reg[ZF] = 1;
-					break;
-				}
-				else
-				{
-					state.reg[ZF] = 0;
+		break;
+	case CMP:
+		reg[ZFREG] = (reg[arg0] == reg[REGB(word)]);
+		break;
+	case BSR:
+		reg[ZFREG] = 0;
+		for (int i = 31; i > -1; i--) {
+			if (reg[arg0] & (1 << i)) {
+				if (undo != NULL) {
+					undoPush(undo, DESTREG(word), reg[DESTREG(word)]);
 				}
+				reg[DESTREG(word)] = i;
+				reg[ZFREG] = 1;
+				break;
 			}
 		}
-		else if (opcode == BSF) {
-			for (int i = 0; i < 32; i++) {
-				int res = state.reg[arg0] & (1 << i);
-				if (res != 0)
-				{
-					state.reg[arg2] = i;
-					state.reg[ZF] = 1;
-					break;
-				}
-				else
-				{
-					state.reg[ZF] = 0;
+		break;
+	case BSF:
+		reg[ZFREG] = 0;
+		for (int i = 0; i < 32; i++) {
+			if (reg[arg0] & (1 << i)) {
+				if (undo != NULL) {
+					undoPush(undo, DESTREG(word), reg[DESTREG(word)]);
 				}
+				reg[DESTREG(word)] = i;
+				reg[ZFREG] = 1;
+				break;
 			}
+		}
+		break;
+	default:
+		solPrintf("error: illegal opcode 0x%x\n", OPCODE(word));
+		solExit(1);
+	}
+	reg[0] = 0;
+	return(0);
+}
 
-		} else {
-			printf("error: illegal opcode 0x%x\n", opcode);
-			exit(1);
+/*
+ * Atomically add value to *addr and return the old contents, so that faa
+ * works across harts running on different host threads.
+ */
+int
+fetchAdd(int* addr, int value)
+{
+#ifdef _MSC_VER
+	return(_InterlockedExchangeAdd((volatile long*)addr, value));
+#else
+	return(__atomic_fetch_add(addr, value, __ATOMIC_SEQ_CST));
+#endif
+}
+
+/*
+ * Map the input file for the IOINPORT/IOSTATUSPORT ports.  An empty file is
+ * not mapped; it reads as a stream that is already at its end.
+ */
+void
+ioOpenInput(char* fileName)
+{
+#ifdef _WIN32
+	HANDLE file, mapping;
+	LARGE_INTEGER size;
+
+	file = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ, NULL,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &size)) {
+		solPrintf("error: can't open input file %s\n", fileName);
+		solExit(1);
+	}
+	io.in = "";
+	io.inSize = (size_t)size.QuadPart;
+	if (io.inSize > 0) {
+		mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		io.in = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+		if (io.in == NULL) {
+			solPrintf("error: can't map input file %s\n", fileName);
+			solExit(1);
 		}
-		state.reg[0] = 0;
 	}
+#else
+	int fd;
+	struct stat st;
+
+	fd = open(fileName, O_RDONLY);
+	if (fd < 0 || fstat(fd, &st) < 0) {
+		solPrintf("error: can't open input file %s\n", fileName);
+		perror("open");
+		solExit(1);
+	}
+	io.in = "";
+	io.inSize = (size_t)st.st_size;
+	if (io.inSize > 0) {
+		io.in = mmap(NULL, io.inSize, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (io.in == MAP_FAILED) {
+			solPrintf("error: can't map input file %s\n", fileName);
+			perror("mmap");
+			solExit(1);
+		}
+		posix_madvise((void*)io.in, io.inSize, POSIX_MADV_SEQUENTIAL);
+	}
+	close(fd);
+#endif
+	io.inPos = 0;
+}
+
+/*
+ * Open the output file for the IOOUTPORT port.  The buffer is flushed at
+ * exit, so every way the simulator stops keeps the words written so far.
+ */
+void
+ioOpenOutput(char* fileName)
+{
+	io.out = fopen(fileName, "wb");
+	io.outBuf = malloc(IOBUFSIZE);
+	if (io.out == NULL || io.outBuf == NULL) {
+		solPrintf("error: can't open output file %s\n", fileName);
+		solExit(1);
+	}
+	setvbuf(io.out, NULL, _IONBF, 0);
+	io.outLen = 0;
+	atexit(ioFlush);
+}
+
+void
+ioFlush(void)
+{
+	if (io.outLen > 0 && fwrite(io.outBuf, 1, io.outLen, io.out) != io.outLen) {
+		solPrintf("error: can't write output file\n");
+	}
+	io.outLen = 0;
+}
+
+/*
+ * Load from an address outside memory.  Returns 0 if the address is not an
+ * input port (or no input file was given).  Reading IOINPORT past the end of
+ * the input gives 0.
+ */
+int
+ioLoad(int address, int* value)
+{
+	long long num = 0;
+	int negative = 0;
+
+	if ((address != IOINPORT && address != IOSTATUSPORT) || io.in == NULL) {
+		return(0);
+	}
+
+	lockTake(&io.lock);
+	while (io.inPos < io.inSize && (io.in[io.inPos] == ' ' ||
+		io.in[io.inPos] == '\t' || io.in[io.inPos] == '\r' ||
+		io.in[io.inPos] == '\n')) {
+		io.inPos++;
+	}
+	if (address == IOSTATUSPORT) {
+		*value = io.inPos < io.inSize;
+		lockGive(&io.lock);
+		return(1);
+	}
+
+	if (io.inPos < io.inSize && (io.in[io.inPos] == '-' ||
+		io.in[io.inPos] == '+')) {
+		negative = io.in[io.inPos++] == '-';
+	}
+	while (io.inPos < io.inSize && io.in[io.inPos] >= '0' &&
+		io.in[io.inPos] <= '9') {
+		num = num * 10 + (io.in[io.inPos++] - '0');
+	}
+	if (io.inPos < io.inSize && io.in[io.inPos] != ' ' &&
+		io.in[io.inPos] != '\t' && io.in[io.inPos] != '\r' &&
+		io.in[io.inPos] != '\n') {
+		lockGive(&io.lock);
+		solPrintf("error in reading input at offset %zu\n", io.inPos);
+		solExit(1);
+	}
+	*value = (int)(negative ? -num : num);
+	lockGive(&io.lock);
+	return(1);
+}
+
+/*
+ * Store to an address outside memory.  Returns 0 if the address is not the
+ * output port (or no output file was given).
+ */
+int
+ioStore(int address, int value)
+{
+	char digits[16];
+	unsigned int num;
+	int n = 0;
+
+	if (address != IOOUTPORT || io.out == NULL) {
+		return(0);
+	}
+
+	num = value < 0 ? 0u - (unsigned int)value : (unsigned int)value;
+	do {
+		digits[n++] = (char)('0' + num % 10);
+		num /= 10;
+	} while (num != 0);
+
+	lockTake(&io.lock);
+	if (io.outLen + sizeof(digits) + 2 > IOBUFSIZE) {
+		ioFlush();
+	}
+	if (value < 0) {
+		io.outBuf[io.outLen++] = '-';
+	}
+	while (n > 0) {
+		io.outBuf[io.outLen++] = digits[--n];
+	}
+	io.outBuf[io.outLen++] = '\n';
+	lockGive(&io.lock);
+	return(1);
 }
 
+/*
+ * printState is called before every instruction, so it keeps the text of
+ * the last state it printed and only reformats the values that changed
+ * since then.  The block is then written with one solWrite.
+ */
 void
 printState(stateType* statePtr)
 {
+	traceType* t = &traceCache;
+	int k = 0;
+	int i;
+
+	if (t->numValues == 0 || t->numMemory != statePtr->numMemory) {
+		buildTrace(statePtr);
+	}
+	else {
+		if (t->value[k] != statePtr->pc) {
+			updateTrace(k, statePtr->pc);
+		}
+		k++;
+		for (i = 0; i < statePtr->numMemory; i++, k++) {
+			if (t->value[k] != statePtr->mem[i]) {
+				updateTrace(k, statePtr->mem[i]);
+			}
+		}
+		for (i = 0; i < NUMREGS + 3; i++, k++) {
+			if (t->value[k] != statePtr->reg[i]) {
+				updateTrace(k, statePtr->reg[i]);
+			}
+		}
+	}
+	solWrite(t->block, t->length);
+}
+
+/*
+ * Format the whole state block into the trace cache, recording where each
+ * value sits so that updateTrace can replace it later.  The text is the
+ * same as
+ *
+ *     printf("\n@@@\nstate:\n\tpc %d\n\tmemory:\n");
+ *     printf("\t\tmem[ %d ] %d\n", ...) for each word,
+ *     printf("\tregisters:\n\t\treg[ %d ] %d\n", ...) for each register,
+ *     printf("end state\n");
+ */
+void
+buildTrace(stateType* statePtr)
+{
+	traceType* t = &traceCache;
+	char* p = t->block;
 	int i;
-	printf("\n@@@\nstate:\n");
-	printf("\tpc %d\n", statePtr->pc);
-	printf("\tmemory:\n");
+
+	t->numMemory = statePtr->numMemory;
+	t->numValues = 0;
+
+	TRACETEXT(p, "\n@@@\nstate:\n\tpc ");
+	p = traceValue(p, statePtr->pc);
+	TRACETEXT(p, "\n\tmemory:\n");
 	for (i = 0; i < statePtr->numMemory; i++) {
-		printf("\t\tmem[ %d ] %d\n", i, statePtr->mem[i]);
+		TRACETEXT(p, "\t\tmem[ ");
+		p += formatInt(p, i);
+		TRACETEXT(p, " ] ");
+		p = traceValue(p, statePtr->mem[i]);
+		TRACETEXT(p, "\n");
 	}
-	printf("\tregisters:\n");
-	for (i = 0; i < NUMREGS; i++) {
-		printf("\t\treg[ %d ] %d\n", i, statePtr->reg[i]);
+	TRACETEXT(p, "\tregisters:\n");
+	for (i = 0; i < NUMREGS + 3; i++) {
+		TRACETEXT(p, "\t\treg[ ");
+		if (i == BRREG) {
+			TRACETEXT(p, "BR");
+		}
+		else if (i == IRREG) {
+			TRACETEXT(p, "IR");
+		}
+		else if (i == ZFREG) {
+			TRACETEXT(p, "ZF");
+		}
+		else {
+			p += formatInt(p, i);
+		}
+		TRACETEXT(p, " ] ");
+		p = traceValue(p, statePtr->reg[i]);
+		TRACETEXT(p, "\n");
+	}
+	TRACETEXT(p, "end state\n");
+	t->length = (int)(p - t->block);
+}
+
+/*
+ * Append a value while building the trace block and remember its place.
+ */
+char*
+traceValue(char* p, int value)
+{
+	traceType* t = &traceCache;
+	int k = t->numValues++;
+
+	t->value[k] = value;
+	t->offset[k] = (int)(p - t->block);
+	t->width[k] = formatInt(p, value);
+	return(p + t->width[k]);
+}
+
+/*
+ * Replace value k of the cached block.  If the number of characters changes
+ * the rest of the block moves and so do the places of the later values.
+ */
+void
+updateTrace(int k, int value)
+{
+	traceType* t = &traceCache;
+	char digits[12];
+	int width = formatInt(digits, value);
+	int delta = width - t->width[k];
+	int end = t->offset[k] + t->width[k];
+	int j;
+
+	if (delta != 0) {
+		memmove(t->block + end + delta, t->block + end, t->length - end);
+		t->length += delta;
+		for (j = k + 1; j < t->numValues; j++) {
+			t->offset[j] += delta;
+		}
+		t->width[k] = width;
 	}
-	printf("\t\treg[ BR ] %d\n", statePtr->reg[8]);
-	printf("\t\treg[ IR ] %d\n", statePtr->reg[9]);
-	printf("\t\treg[ ZF ] %d\n", statePtr->reg[10]);
-	printf("end state\n");
+	memcpy(t->block + t->offset[k], digits, width);
+	t->value[k] = value;
 }
 
+/*
+ * Write value in decimal, as %d would, and return the number of characters.
+ */
 int
-convertNum(int num)
+formatInt(char* p, int value)
+{
+	char digits[12];
+	unsigned int num = value < 0 ? 0u - (unsigned int)value : (unsigned int)value;
+	int n = 0;
+	int length;
+
+	do {
+		digits[n++] = (char)('0' + num % 10);
+		num /= 10;
+	} while (num != 0);
+	if (value < 0) {
+		digits[n++] = '-';
+	}
+	for (length = n; n > 0; ) {
+		*p++ = digits[--n];
+	}
+	return(length);
+}
+
+/*
+ * Final state of a multi-hart run: the shared memory once, then the pc and
+ * registers of every hart.
+ */
+void
+printHarts(stateType* statePtr, hartType* harts, int numHarts)
 {
-	/* convert a 16-bit number into a 32-bit Sun integer */
-	if (num & (1 << 15)) {
-		num -= (1 << 16);
+	int i, h;
+	solPrintf("\n@@@\nstate:\n");
+	solPrintf("\tmemory:\n");
+	for (i = 0; i < statePtr->numMemory; i++) {
+		solPrintf("\t\tmem[ %d ] %d\n", i, statePtr->mem[i]);
+	}
+	for (h = 0; h < numHarts; h++) {
+		solPrintf("\thart %d:\n", h);
+		solPrintf("\t\tpc %d\n", harts[h].pc);
+		for (i = 0; i < NUMREGS; i++) {
+			solPrintf("\t\treg[ %d ] %d\n", i, harts[h].reg[i]);
+		}
+		solPrintf("\t\treg[ BR ] %d\n", harts[h].reg[BRREG]);
+		solPrintf("\t\treg[ IR ] %d\n", harts[h].reg[IRREG]);
+		solPrintf("\t\treg[ ZF ] %d\n", harts[h].reg[ZFREG]);
+	}
+	solPrintf("end state\n");
+}
+
+/*
+ * Allocate an undo log of at least size entries.
+ */
+undoType*
+undoCreate(int size)
+{
+	undoType* undo = malloc(sizeof(undoType));
+	unsigned int n;
+
+	for (n = MINUNDOSIZE; n < (unsigned int)size; n <<= 1) {
+	}
+	if (undo == NULL ||
+		(undo->entry = malloc(n * sizeof(undoEntryType))) == NULL) {
+		solPrintf("error: can't allocate an undo log of %d entries\n", size);
+		solExit(1);
+	}
+	undo->mask = n - 1;
+	undo->head = 0;
+	undo->tail = 0;
+	undo->limit = n - MAXUNDOWRITES;
+	undo->instructions = 0;
+	undo->pc = -1;
+	return(undo);
+}
+
+/*
+ * Start the log of the instruction word at pc with the old values of the
+ * registers it writes.  Called by step before the instruction runs; step
+ * itself logs the writes that depend on what the instruction computes.
+ * Static so that it is compiled into step, the only caller.
+ */
+static void
+undoRecord(undoType* undo, int pc, int word, int* reg)
+{
+	int writes = (unsigned int)OPCODE(word) < sizeof(undoWrites) ?
+		undoWrites[OPCODE(word)] : W_NONE;
+
+	undoFlush(undo);
+	if (undo->head - undo->tail > undo->limit) {
+		undoDrop(undo);
+	}
+	undo->pc = pc;
+	undo->instructions++;
+	if (writes & UNDODEST) {
+		undoPush(undo, DESTREG(word), reg[DESTREG(word)]);
+	}
+	if (writes & (W_REGA | W_REGB | W_ZF | W_BRIR)) {
+		if (writes & W_REGA) {
+			undoPush(undo, REGA(word), reg[REGA(word)]);
+		}
+		if (writes & W_REGB) {
+			undoPush(undo, REGB(word), reg[REGB(word)]);
+		}
+		if (writes & W_ZF) {
+			undoPush(undo, ZFREG, reg[ZFREG]);
+		}
+		if (writes & W_BRIR) {
+			undoPush(undo, BRREG, reg[BRREG]);
+			undoPush(undo, IRREG, reg[IRREG]);
+		}
+	}
+}
+
+/*
+ * Append one entry.  undoRecord has already made room for it.
+ */
+void
+undoPush(undoType* undo, int where, int old)
+{
+	undoEntryType* entry = &undo->entry[undo->head++ & undo->mask];
+
+	entry->old = old;
+	entry->where = (short)where;
+	entry->pc = (short)undo->pc;
+	undo->pc = -1;
+}
+
+/*
+ * Give the last instruction logged its UNDONONE entry if it has overwritten
+ * nothing, so that every instruction in the log has an entry with its pc.
+ */
+void
+undoFlush(undoType* undo)
+{
+	if (undo->pc >= 0) {
+		undoPush(undo, UNDONONE, 0);
+	}
+}
+
+/*
+ * Drop the oldest instructions from a full log.  A sixteenth of the ring is
+ * freed at a time, so this runs once every few thousand instructions rather
+ * than on each one.
+ */
+void
+undoDrop(undoType* undo)
+{
+	unsigned int keep = undo->limit - ((undo->mask + 1) >> 4);
+
+	while (undo->head - undo->tail > keep) {
+		do {
+			undo->tail++;
+		} while (undo->tail != undo->head &&
+			undo->entry[undo->tail & undo->mask].pc < 0);
+		undo->instructions--;
+	}
+}
+
+/*
+ * Undo the last instruction in the log.  Returns 0 if the log is empty.
+ */
+int
+undoBack(undoType* undo, stateType* statePtr)
+{
+	undoEntryType* entry;
+
+	if (undo->head == undo->tail) {
+		return(0);
+	}
+	do {
+		entry = &undo->entry[--undo->head & undo->mask];
+		if (entry->where >= UNDOMEM) {
+			statePtr->mem[entry->where - UNDOMEM] = entry->old;
+		}
+		else if (entry->where != UNDONONE) {
+			statePtr->reg[entry->where] = entry->old;
+		}
+	} while (entry->pc < 0);
+	statePtr->pc = entry->pc;
+	undo->instructions--;
+	return(1);
+}
+
+/*
+ * Find the last instruction in the log that wrote where.  Returns how many
+ * instructions back it is (1 for the last one) with its pc and the value it
+ * overwrote, or 0 if no instruction in the log wrote where.
+ */
+int
+undoFind(undoType* undo, int where, int* pc, int* old)
+{
+	undoEntryType* entry;
+	unsigned int i;
+	int back = 1;
+	int found = 0;
+
+	for (i = undo->head; i != undo->tail; ) {
+		entry = &undo->entry[--i & undo->mask];
+		if (!found && entry->where == where) {
+			found = 1;
+			*old = entry->old;
+		}
+		if (entry->pc >= 0) {
+			if (found) {
+				*pc = entry->pc;
+				return(back);
+			}
+			back++;
+		}
+	}
+	return(0);
+}
+
+/*
+ * Reverse-execution prompt, entered when a run with an undo log stops.
+ * Commands are read from stdin:
+ *
+ *     reverse-step [n]        undo the last n instructions (default 1)
+ *     reverse-continue <pc>   undo instructions until the pc is <pc>
+ *     last mem <address>      the last instruction that wrote mem[address]
+ *     last reg <r>            the same for reg r: 0-7, BR, IR or ZF
+ *     print                   print the current state
+ *     quit
+ */
+void
+debug(undoType* undo, stateType* statePtr)
+{
+	char line[MAXLINELENGTH], command[MAXLINELENGTH], arg0[MAXLINELENGTH],
+		arg1[MAXLINELENGTH];
+	int num, n, where, pc, old;
+
+	undoFlush(undo);
+	solPrintf("undo log holds the last %d instructions\n",
+		undo->instructions);
+	for (; 1; ) {
+		solPrintf("(ssol) ");
+		fflush(stdout);
+		if (fgets(line, MAXLINELENGTH, stdin) == NULL) {
+			solPrintf("\n");
+			return;
+		}
+		command[0] = arg0[0] = arg1[0] = '\0';
+		sscanf(line, "%s %s %s", command, arg0, arg1);
+
+		if (!strcmp(command, "reverse-step")) {
+			num = arg0[0] != '\0' ? atoi(arg0) : 1;
+			for (n = 0; n < num && undoBack(undo, statePtr); n++) {
+			}
+			if (n < num) {
+				solPrintf("reached the start of the undo log\n");
+			}
+			solPrintf("pc %d, %d instructions left in the undo log\n",
+				statePtr->pc, undo->instructions);
+		}
+		else if (!strcmp(command, "reverse-continue") && arg0[0] != '\0') {
+			num = atoi(arg0);
+			for (n = undoBack(undo, statePtr); n && statePtr->pc != num;
+				n = undoBack(undo, statePtr)) {
+			}
+			if (!n) {
+				solPrintf("pc %d not reached; at the start of the undo log\n",
+					num);
+			}
+			solPrintf("pc %d, %d instructions left in the undo log\n",
+				statePtr->pc, undo->instructions);
+		}
+		else if (!strcmp(command, "last") && arg1[0] != '\0' &&
+			(!strcmp(arg0, "mem") || !strcmp(arg0, "reg"))) {
+			num = atoi(arg1);
+			if (!strcmp(arg0, "mem")) {
+				where = num >= 0 && num < NUMMEMORY ? UNDOMEM + num : UNDONONE;
+			}
+			else if (!strcmp(arg1, "BR") || !strcmp(arg1, "br")) {
+				where = BRREG;
+			}
+			else if (!strcmp(arg1, "IR") || !strcmp(arg1, "ir")) {
+				where = IRREG;
+			}
+			else if (!strcmp(arg1, "ZF") || !strcmp(arg1, "zf")) {
+				where = ZFREG;
+			}
+			else {
+				where = num >= 0 && num < NUMREGS ? num : UNDONONE;
+			}
+			if (where == UNDONONE) {
+				solPrintf("no such %s\n", arg0);
+			}
+			else if ((n = undoFind(undo, where, &pc, &old)) == 0) {
+				solPrintf("%s[ %s ] is not written in the undo log\n", arg0,
+					arg1);
+			}
+			else {
+				solPrintf("%s[ %s ] last written at pc %d, %d instructions "
+					"back; it was %d before\n", arg0, arg1, pc, n, old);
+			}
+		}
+		else if (!strcmp(command, "print")) {
+			printState(statePtr);
+		}
+		else if (!strcmp(command, "quit")) {
+			return;
+		}
+		else if (command[0] != '\0') {
+			solPrintf("commands: reverse-step [n], reverse-continue <pc>, "
+				"last mem <address>, last reg <r>, print, quit\n");
+		}
 	}
-	return(num);
 }
@@ -0,0 +1,12 @@
+        lw      0       2       n       run: ssol testFAA.mc -harts 4 -det
+        lw      0       3       one
+        lw      0       4       addr    reg4 = address of cnt
+loop    faa     4       3       5       reg5 = cnt, cnt = cnt + 1
+        sub     2       3       2       decrement reg2
+        beq     2       0       done
+        beq     0       0       loop
+done    halt                            end of program
+n       .fill   5
+one     .fill   1
+addr    .fill   cnt
+cnt     .fill   0                       4 harts x 5 adds = 20
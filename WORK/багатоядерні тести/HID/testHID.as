@@ -0,0 +1,12 @@
+        hid     1                       run: ssol testHID.mc -harts 3 -det
+        lw      0       2       base    reg2 = address of slot0
+        add     1       2       2       reg2 = address of this hart's slot
+        lw      0       3       ten
+        add     1       3       3       reg3 = hart id + 10
+        sw      2       3       0       store it in the slot
+done    halt                            end of program
+base    .fill   slot0
+ten     .fill   10
+slot0   .fill   0
+slot1   .fill   0
+slot2   .fill   0
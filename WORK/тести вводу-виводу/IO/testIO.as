@@ -0,0 +1,13 @@
+        lw      0       1       inp     run: ssol testIO.mc -in input.txt -out out.txt
+        lw      0       4       outp    out.txt must then equal expected.txt
+        lw      0       5       stat
+loop    lw      5       2       0       reg2 = 1 while input remains
+        beq     2       0       done
+        lw      1       3       0       reg3 = next word of the input file
+        add     3       3       3       double it
+        sw      4       3       0       append it to the output file
+        beq     0       0       loop
+done    halt                            end of program
+inp     .fill   256                     input port
+outp    .fill   257                     output port
+stat    .fill   258                     status port